@@ -5,203 +5,1217 @@
  * @copyright Copyright (c) 2023-2024
  */
 
+#include <cassert>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <thread>
+#include <vector>
 #include "ai.h"
-#include "controller.h"
+#include "endgame.h"
+#include "stability.h"
 #define INF 10000
 
-uint64_t calcZobristHash(Board board)
+#define DEFAULT_TABLE_SIZE_MB 64
+#define DEFAULT_GAME_TIME 60.0
+#define DEFAULT_WEIGHTS_PATH "edaversi.weights"
+#define DEFAULT_BOOK_PATH "edaversi.book"
+
+#define MIN_MOVE_TIME 0.05
+#define TIME_CHECK_INTERVAL 1024
+
+#define HASH_MOVE_PRIORITY (1 << 30)
+#define KILLER_MOVE_PRIORITY (1 << 29)
+#define HISTORY_MAX (1 << 20)
+
+#define SHALLOW_ORDERING_MIN_DEPTH 5
+#define SHALLOW_ORDERING_DEPTH 2
+
+#define ASPIRATION_MIN_DEPTH 4
+#define ASPIRATION_WINDOW 8
+
+#define DEFAULT_ENDGAME_EMPTIES 16
+#define ENDGAME_MIDGAME_DEPTH 4
+
+// Finished games score beyond any evaluation, by how much they are won
+#define WIN_SCORE 1000
+
+// Canonical table keys, per player to move, kept apart from Zobrist keys
+static const uint64_t CANONICAL_HASH_KEYS[2] = {
+    0x63616e6f6e626c6bULL,
+    0x63616e6f6e776874ULL,
+};
+
+// Tabla de pesos estáticos para Reversi
+static const int POSITIONAL_WEIGHTS[BOARD_SIZE][BOARD_SIZE] = {
+    {120, -20, 20,  5,  5, 20, -20, 120},
+    {-20, -40, -5, -5, -5, -5, -40, -20},
+    { 20,  -5, 15,  3,  3, 15,  -5,  20},
+    {  5,  -5,  3,  3,  3,  3,  -5,   5},
+    {  5,  -5,  3,  3,  3,  3,  -5,   5},
+    { 20,  -5, 15,  3,  3, 15,  -5,  20},
+    {-20, -40, -5, -5, -5, -5, -40, -20},
+    {120, -20, 20,  5,  5, 20, -20, 120}
+};
+
+/**
+ * @brief Returns the static weight of a square.
+ *
+ * @param square The square index.
+ * @return The weight.
+ */
+static inline int getSquareWeight(int square)
+{
+    return POSITIONAL_WEIGHTS[square / BOARD_SIZE][square % BOARD_SIZE];
+}
+
+static int evaluateTerms(const Position &position, const EvalState &eval, Player maxPlayer);
+static Square searchBestMove(AIEngine &engine, const GameModel &model, const SearchLimits &limits, const SearchResult *pondered, SearchResult &result);
+
+/**
+ * @brief In debug builds, checks the incremental evaluation terms against a
+ * full recomputation.
+ */
+#define CHECK_EVAL_STATE(state) \
+    assert(isEvalStateValid(state))
+
+#ifndef NDEBUG
+static bool isEvalStateValid(const SearchState &state)
+{
+    EvalState eval;
+    getEvalState(state.position, eval);
+
+    // Pattern indices are only kept up to date when they are used
+    if (!state.weights->weights)
+        eval.patterns = state.eval.patterns;
+
+    return !memcmp(&eval, &state.eval, sizeof(eval));
+}
+#endif
+
+static AIEngine defaultEngine;
+static bool defaultEngineReady = false;
+
+static std::thread searchThread;
+static std::atomic<bool> searchDone(false);
+static Square searchMove;
+static SearchResult searchResult;
+
+/**
+ * @brief A reply the opponent may play while we ponder, and our search of
+ * the position it leads to.
+ */
+struct PonderLine
+{
+    Position position;   // After the reply, with us to move
+    SearchResult result; // Deepest completed iteration (depth 0 if none yet)
+};
+
+static PonderLine ponderLines[BOARD_SIZE * BOARD_SIZE];
+static int ponderLineCount = 0;
+static std::thread ponderThreads[SEARCH_MAX_THREADS];
+static int ponderThreadCount = 0;
+static std::atomic<bool> ponderStop(false);
+static bool pondering = false;
+
+void getDefaultAIConfig(AIConfig &config)
 {
-    // TODO: completar
-    return 1234;
+    config.tableSizeMB = DEFAULT_TABLE_SIZE_MB;
+    config.hugePages = false;
+
+    config.threads = std::thread::hardware_concurrency();
+    if (config.threads < 1)
+        config.threads = 1;
+    if (config.threads > SEARCH_MAX_THREADS)
+        config.threads = SEARCH_MAX_THREADS;
+
+    config.shallowOrdering = false;
+    config.canonicalHashing = false;
+
+    config.endgameEmpties = DEFAULT_ENDGAME_EMPTIES;
+    config.endgameWLD = false;
+
+    config.maxDepth = SEARCH_MAX_DEPTH;
+    config.moveTime = 0;
+    config.gameTime = DEFAULT_GAME_TIME;
+
+    config.weightsPath = DEFAULT_WEIGHTS_PATH;
+    config.bookPath = DEFAULT_BOOK_PATH;
 }
 
-unsigned int exploratedNodes = 0;
+void initAIEngine(AIEngine &engine, const AIConfig &config)
+{
+    engine.config = config;
+    engine.stopSearch = false;
+
+    if (!initTranspositionTable(engine.table, config.tableSizeMB, config.hugePages))
+        std::cerr << "Could not allocate the transposition table" << std::endl;
+
+    // Without a weight file the built-in evaluation is used
+    engine.weights = PatternWeights();
+    if (config.weightsPath)
+        loadPatternWeights(engine.weights, config.weightsPath);
+
+    engine.book = OpeningBook();
+    if (config.bookPath)
+        loadOpeningBook(engine.book, config.bookPath);
+}
+
+void freeAIEngine(AIEngine &engine)
+{
+    freeTranspositionTable(engine.table);
+    freePatternWeights(engine.weights);
+    freeOpeningBook(engine.book);
+}
+
+/**
+ * @brief Returns a monotonic time in seconds, for search deadlines.
+ */
+static double getSearchClock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void getSearchLimits(const AIEngine &engine, const GameModel &model, SearchLimits &limits)
+{
+    const AIConfig &config = engine.config;
+
+    limits.depth = config.maxDepth;
+    limits.softTime = 0;
+    limits.hardTime = 0;
+
+    if (config.moveTime > 0)
+    {
+        // Fixed budget per move: don't start an iteration past half of it
+        limits.softTime = config.moveTime / 2;
+        limits.hardTime = config.moveTime;
+    }
+    else if (config.gameTime > 0)
+    {
+        // Spread what is left of the game budget over our remaining moves
+        double timeLeft = config.gameTime - getTimer(model, model.currentPlayer);
+        int emptyCount = BOARD_SIZE * BOARD_SIZE - getScore(model, PLAYER_BLACK) - getScore(model, PLAYER_WHITE);
+        int movesLeft = (emptyCount + 1) / 2;
+
+        double moveTime = timeLeft / (movesLeft + 1);
+        if (moveTime < MIN_MOVE_TIME)
+            moveTime = MIN_MOVE_TIME;
+
+        limits.softTime = moveTime;
+        limits.hardTime = 3 * moveTime;
+        if (limits.hardTime > timeLeft / 2)
+            limits.hardTime = (timeLeft / 2 > moveTime) ? timeLeft / 2 : moveTime;
+    }
+}
+
+/**
+ * @brief Creates the default engine on first use.
+ */
+static AIEngine &getDefaultEngine()
+{
+    if (!defaultEngineReady)
+    {
+        AIConfig config;
+        getDefaultAIConfig(config);
+        initAIEngine(defaultEngine, config);
+        defaultEngineReady = true;
+    }
+
+    return defaultEngine;
+}
 
 Square getBestMove(GameModel &model)
 {
-    // To-do: your code goes here...
-    
-    return findBestMove(model, 7);
+    AIEngine &engine = getDefaultEngine();
+
+    SearchLimits limits;
+    getSearchLimits(engine, model, limits);
+
+    SearchResult result;
+    return findBestMove(engine, model, limits, result);
+}
+
+void startBestMoveSearch(const GameModel &model)
+{
+    cancelBestMoveSearch();
+
+    AIEngine &engine = getDefaultEngine();
+    engine.stopSearch = false;
+
+    // Limits are computed here: the model clocks must be read on this thread
+    SearchLimits limits;
+    getSearchLimits(engine, model, limits);
+
+    // If the opponent played a pondered reply, its search is carried on
+    Position position;
+    getPosition(model, position);
+
+    const PonderLine *line = NULL;
+    for (int i = 0; i < ponderLineCount; i++)
+    {
+        const Position &pondered = ponderLines[i].position;
+        if ((pondered.discs[PLAYER_BLACK] == position.discs[PLAYER_BLACK]) &&
+            (pondered.discs[PLAYER_WHITE] == position.discs[PLAYER_WHITE]) &&
+            (pondered.currentPlayer == position.currentPlayer) &&
+            ponderLines[i].result.depth)
+            line = &ponderLines[i];
+    }
+
+    searchDone = false;
+    searchThread = std::thread([model, limits, line]()
+                               {
+                                   searchMove = searchBestMove(defaultEngine, model, limits,
+                                                               line ? &line->result : NULL, searchResult);
+                                   searchDone = true;
+                               });
+}
+
+bool pollBestMoveSearch(Square &move, SearchResult &result)
+{
+    if (!searchThread.joinable() || !searchDone)
+        return false;
+
+    searchThread.join();
+    move = searchMove;
+    result = searchResult;
+
+    return true;
+}
+
+bool isBestMoveSearchRunning()
+{
+    return searchThread.joinable();
+}
+
+void cancelBestMoveSearch()
+{
+    stopPondering();
+
+    if (!searchThread.joinable())
+        return;
+
+    defaultEngine.stopSearch = true;
+    searchThread.join();
+}
+
+
+/**
+ * @brief Plays a move (or a pass, with square -1) on the search position.
+ *
+ * @param state The search state.
+ * @param square The square index of the move.
+ */
+static void playSearchMove(SearchState &state, int square)
+{
+    state.evalStack[state.ply] = state.eval;
+    MoveUndo &undo = state.undoStack[state.ply++];
+
+    if (square < 0)
+    {
+        makePass(state.position, undo);
+        return;
+    }
+
+    makeMove(state.position, square, undo);
+
+    // Update the evaluation terms with the placed and flipped discs
+    Player player = undo.player;
+    int flipCount = countBits(undo.flips);
+    int flipWeight = 0;
+
+    for (Bitboard flips = undo.flips; flips; flips &= flips - 1)
+        flipWeight += getSquareWeight(getFirstBit(flips));
+
+    state.eval.discs[player] += flipCount + 1;
+    state.eval.discs[player ^ 1] -= flipCount;
+    state.eval.positional[player] += getSquareWeight(square) + flipWeight;
+    state.eval.positional[player ^ 1] -= flipWeight;
+    if (state.weights->weights)
+        updatePatternIndices(state.eval.patterns, player, square, undo.flips);
+
+    CHECK_EVAL_STATE(state);
+}
+
+/**
+ * @brief Takes back the last move played with playSearchMove().
+ *
+ * @param state The search state.
+ */
+static void undoSearchMove(SearchState &state)
+{
+    unmakeMove(state.position, state.undoStack[--state.ply]);
+    state.eval = state.evalStack[state.ply];
+}
+
+bool isSearchAborted(SearchState &state)
+{
+    if (((++state.stats.nodes % TIME_CHECK_INTERVAL) == 0) &&
+        (((state.deadline > 0) && (getSearchClock() >= state.deadline)) ||
+         (state.stop && state.stop->load(std::memory_order_relaxed))))
+        state.aborted = true;
+
+    return state.aborted;
+}
+
+/**
+ * @brief Returns the transposition table key of the search position: its
+ * Zobrist hash or, with canonical hashing, the hash of whichever of its 8
+ * symmetric orientations sorts first, so they all share table entries.
+ *
+ * @param state The search state.
+ * @param symmetry Receives the symmetry that maps the position onto the
+ * orientation hashed (0 without canonical hashing).
+ * @return The key.
+ */
+static uint64_t getSearchKey(const SearchState &state, int &symmetry)
+{
+    const Position &position = state.position;
+    symmetry = 0;
+
+    if (!state.canonicalHashing)
+        return position.hash;
+
+    Bitboard players[SYMMETRY_COUNT];
+    Bitboard opponents[SYMMETRY_COUNT];
+    getSymmetricBitboards(position.discs[position.currentPlayer], players);
+    getSymmetricBitboards(position.discs[position.currentPlayer ^ 1], opponents);
 
-    // +++ TEST
-    // Returns a random valid move...
-    Moves validMoves;
-    getValidMoves(model, validMoves);
+    for (int i = 1; i < SYMMETRY_COUNT; i++)
+    {
+        if ((players[i] < players[symmetry]) ||
+            ((players[i] == players[symmetry]) && (opponents[i] < opponents[symmetry])))
+            symmetry = i;
+    }
 
-    int index = rand() % validMoves.size();
-    return validMoves[index];
-    // --- TEST
+    return getDiscsHash(players[symmetry], opponents[symmetry]) ^
+           CANONICAL_HASH_KEYS[position.currentPlayer];
 }
 
+/**
+ * @brief Looks the search position up in the transposition table, mapping
+ * the stored move back to the position's orientation.
+ */
+static bool probeSearchResult(SearchState &state, TranspositionTable &table, NodePunctuation &node)
+{
+    int symmetry;
+    state.stats.tableProbes++;
+    if (!probeTranspositionTable(table, getSearchKey(state, symmetry), node))
+        return false;
+
+    state.stats.tableHits++;
+
+    if (node.move >= 0)
+        node.move = getSymmetricSquare(node.move, getInverseSymmetry(symmetry));
 
+    return true;
+}
 
-Square findBestMove(const GameModel& model, int depth) 
+/**
+ * @brief Stores a search result, classifying it against the search window.
+ */
+static void storeSearchResult(SearchState &state, TranspositionTable &table, int depth, int eval, int alpha, int beta, int move)
 {
+    int symmetry;
+    uint64_t key = getSearchKey(state, symmetry);
+
+    NodePunctuation node;
+    node.bound = (eval <= alpha) ? UPPER_BOUND : (eval >= beta) ? LOWER_BOUND : EXACT;
+    node.eval = eval;
+    node.depth = depth;
+    node.move = (move >= 0) ? getSymmetricSquare(move, symmetry) : move;
+
+    storeTranspositionTable(table, key, node);
+}
+
+/**
+ * @brief Sorts moves by priority, highest first (insertion sort: there are
+ * never more than a few dozen moves).
+ */
+static void sortMoves(int moves[], int priorities[], int count)
+{
+    for (int i = 1; i < count; i++)
+    {
+        int move = moves[i];
+        int priority = priorities[i];
+        int j = i;
+
+        for (; (j > 0) && (priorities[j - 1] < priority); j--)
+        {
+            moves[j] = moves[j - 1];
+            priorities[j] = priorities[j - 1];
+        }
+
+        moves[j] = move;
+        priorities[j] = priority;
+    }
+}
+
+/**
+ * @brief Orders moves for the search: the stored best move first, then the
+ * killer moves of this ply, then by history score, with the static square
+ * weights breaking ties.
+ *
+ * @param state The search state.
+ * @param moves The legal moves.
+ * @param hashMove The stored best move, -1 if none.
+ * @param orderedMoves Receives the moves in search order.
+ * @param priorities Receives the priority of each ordered move.
+ * @return The number of moves.
+ */
+static int orderMoves(SearchState &state, Bitboard moves, int hashMove, int orderedMoves[], int priorities[])
+{
+    Player player = state.position.currentPlayer;
+    const int *killers = state.killers[state.ply];
+    int count = 0;
+
+    for (; moves; moves &= moves - 1)
+    {
+        int move = getFirstBit(moves);
+        int priority;
+
+        if (move == hashMove)
+            priority = HASH_MOVE_PRIORITY;
+        else if (move == killers[0])
+            priority = KILLER_MOVE_PRIORITY + 1;
+        else if (move == killers[1])
+            priority = KILLER_MOVE_PRIORITY;
+        else
+            priority = (state.history[player][move] << 8) +
+                       (POSITIONAL_WEIGHTS[move / BOARD_SIZE][move % BOARD_SIZE] + 128);
+
+        orderedMoves[count] = move;
+        priorities[count] = priority;
+        count++;
+    }
+
+    sortMoves(orderedMoves, priorities, count);
+
+    return count;
+}
+
+/**
+ * @brief Records a beta cutoff: updates the cutoff counters, the killer
+ * moves of this ply and the history table.
+ *
+ * @param state The search state.
+ * @param move The move that caused the cutoff.
+ * @param moveIndex The position of the move in the search order.
+ * @param depth The remaining depth.
+ */
+static void recordCutoff(SearchState &state, int move, int moveIndex, int depth)
+{
+    recordSearchCutoff(state.stats, moveIndex);
+
+    int *killers = state.killers[state.ply];
+    if (killers[0] != move)
+    {
+        killers[1] = killers[0];
+        killers[0] = move;
+    }
+
+    int *history = state.history[state.position.currentPlayer];
+    history[move] += depth * depth;
+
+    // Keep history scores bounded, preserving their ratios
+    if (history[move] > HISTORY_MAX)
+        for (int player = 0; player < 2; player++)
+            for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+                state.history[player][square] /= 2;
+}
+
+/**
+ * @brief Reorders moves by the score of a shallow search of each, keeping
+ * the stored best move first.
+ *
+ * @param state The search state.
+ * @param table The transposition table.
+ * @param moves The moves, in search order (the stored best move first, if any).
+ * @param priorities The priorities of the moves.
+ * @param count The number of moves.
+ * @param hasHashMove Whether the first move is the stored best move.
+ */
+static void orderMovesByShallowSearch(SearchState &state, TranspositionTable &table, int moves[], int priorities[], int count, bool hasHashMove)
+{
+    for (int i = hasHashMove ? 1 : 0; i < count; i++)
+    {
+        playSearchMove(state, moves[i]);
+        priorities[i] = -negamax(state, table, SHALLOW_ORDERING_DEPTH, -INF, INF);
+        undoSearchMove(state);
+    }
+
+    sortMoves(moves, priorities, count);
+}
+
+/**
+ * @brief Searches every root move to a fixed depth with principal variation
+ * search, keeping alpha between root moves.
+ *
+ * @param state The search state, at the root.
+ * @param table The transposition table.
+ * @param depth The depth.
+ * @param alpha The lower bound of the search window.
+ * @param beta The upper bound of the search window.
+ * @param bestMove Receives the best move's square index.
+ * @return The best move's score (meaningless if the search was aborted).
+ */
+static int searchRoot(SearchState &state, TranspositionTable &table, int depth, int alpha, int beta, int &bestMove)
+{
+    int originalAlpha = alpha;
     int bestValue = -INF;
-    Square bestMove = { -1, -1 };
+    bestMove = -1;
+
+    NodePunctuation node;
+    int hashMove = probeSearchResult(state, table, node) ? node.move : -1;
 
-    Moves validMoves;
-    getValidMoves(model, validMoves);
+    int moves[BOARD_SIZE * BOARD_SIZE];
+    int priorities[BOARD_SIZE * BOARD_SIZE];
+    int moveCount = orderMoves(state, getPositionMoves(state.position), hashMove, moves, priorities);
 
-    for (const auto& move : validMoves) 
+    for (int i = 0; i < moveCount; i++) 
 	{
-        GameModel nextModel = model;
-        playMove(nextModel, move);
+        int move = moves[i];
+        int moveValue;
+
+        playSearchMove(state, move);
+        if (i == 0)
+            moveValue = -negamax(state, table, depth - 1, -beta, -alpha);
+        else
+        {
+            moveValue = -negamax(state, table, depth - 1, -alpha - 1, -alpha);
+            if ((moveValue > alpha) && (moveValue < beta))
+                moveValue = -negamax(state, table, depth - 1, -beta, -alpha);
+        }
+        undoSearchMove(state);
 
-        NodesTable table;
-        int moveValue = minimax(nextModel, table, depth - 1,-INF,INF, false, model.currentPlayer);
+        if (state.aborted)
+            return 0;
 
         if (moveValue > bestValue) 
 		{
             bestValue = moveValue;
             bestMove = move;
         }
+        if (moveValue > alpha)
+            alpha = moveValue;
+        if (alpha >= beta)
+            break;
     }
 
-    return bestMove;
+    if (bestMove >= 0)
+        storeSearchResult(state, table, depth, bestValue, originalAlpha, beta, bestMove);
+
+    return bestValue;
 }
 
-//alpha-beta pruning minimax, alpha setea el mejor valor que el maximizador puede asegurar en ese nivel o niveles superiores y beta el mejor valor que el minimizador puede asegurar en ese nivel o niveles superiores
-int minimax(const GameModel& model, NodesTable& table, int depth, int alpha, int beta, bool maximizingPlayer, Player maxPlayer)
+/**
+ * @brief Searches the root inside an aspiration window around the previous
+ * iteration's score, widening it on each fail low or fail high.
+ *
+ * @param state The search state, at the root.
+ * @param table The transposition table.
+ * @param depth The depth.
+ * @param previousScore The previous iteration's score.
+ * @param bestMove Receives the best move's square index.
+ * @return The best move's score (meaningless if the search was aborted).
+ */
+static int searchAspirationWindow(SearchState &state, TranspositionTable &table, int depth, int previousScore, int &bestMove)
 {
-    // Caso base
-    if (depth == 0 || model.gameOver) 
+    int delta = ASPIRATION_WINDOW;
+    int alpha = previousScore - delta;
+    int beta = previousScore + delta;
+
+    while (true)
     {
-        return evaluateBoard(model.board, maxPlayer);
+        if (alpha < -INF)
+            alpha = -INF;
+        if (beta > INF)
+            beta = INF;
+
+        int score = searchRoot(state, table, depth, alpha, beta, bestMove);
+
+        if (state.aborted)
+            return 0;
+
+        if ((score > alpha) && (score < beta))
+            return score;
+
+        delta *= 2;
+        if (score <= alpha)
+            alpha = score - delta;
+        else
+            beta = score + delta;
     }
+}
+
+/**
+ * @brief Prepares a search state for a search from the model's position.
+ */
+static void initSearchState(SearchState &state, const AIEngine &engine, const GameModel &model, double deadline, const std::atomic<bool> *stop)
+{
+    const AIConfig &config = engine.config;
+
+    getPosition(model, state.position);
+    getEvalState(state.position, state.eval);
+    state.weights = &engine.weights;
+    state.ply = 0;
+    clearSearchStats(state.stats);
+    state.shallowOrdering = config.shallowOrdering;
+    state.endgameEmpties = config.endgameEmpties;
+    state.endgameWLD = config.endgameWLD;
+    state.canonicalHashing = config.canonicalHashing;
+
+    memset(state.killers, -1, sizeof(state.killers));
+    memset(state.history, 0, sizeof(state.history));
+    state.aborted = false;
+    state.deadline = deadline;
+    state.stop = stop;
+}
+
+/**
+ * @brief Iterative deepening loop.
+ *
+ * @param state The search state, at the root.
+ * @param table The transposition table.
+ * @param limits The search limits.
+ * @param firstDepth The first depth searched.
+ * @param startTime The search start time (search clock).
+ * @param previous A completed search of the same root to carry on from
+ *        (its move and score seed the result), or NULL.
+ * @param result Receives the last completed iteration.
+ */
+static void iterateDeepening(SearchState &state, TranspositionTable &table, const SearchLimits &limits, int firstDepth, double startTime, const SearchResult *previous, SearchResult &result)
+{
+    Bitboard moves = getPositionMoves(state.position);
+    int emptyCount = countBits(~(state.position.discs[PLAYER_BLACK] | state.position.discs[PLAYER_WHITE]));
+
+    result.move = GAME_INVALID_SQUARE;
+    result.score = 0;
+    result.depth = 0;
+    result.solved = false;
 
-    Moves validMoves;
-    getValidMoves(model, validMoves);
+    if (moves)
+        result.move = getIndexSquare(getFirstBit(moves));
 
-    if (validMoves.empty()) 
+    // Sigo una búsqueda anterior: su jugada es el respaldo y su valor centra
+    // la ventana de aspiración
+    if (previous)
     {
-        // Si no hay jugadas válidas, el jugador pasa turno automáticamente
-        GameModel nextModel = model;
-        nextModel.currentPlayer = (model.currentPlayer == PLAYER_BLACK ? PLAYER_WHITE : PLAYER_BLACK);
-        return minimax(nextModel, table, depth - 1,alpha,beta, !maximizingPlayer, maxPlayer);
+        result.move = previous->move;
+        result.score = previous->score;
+        result.depth = previous->depth;
     }
 
-    if (maximizingPlayer) 
+    // Profundización iterativa: me quedo con la última profundidad completa
+    for (int depth = firstDepth; moves && (depth <= limits.depth); depth++)
     {
-        int maxEval = -INF;
-        for (const auto& move : validMoves) 
+        int bestMove;
+        double iterationStart = getSearchClock();
+        uint64_t iterationNodes = state.stats.nodes;
+
+        // Cerca del final, tras unas iteraciones cortas (jugada de respaldo y
+        // orden), resuelvo el final de forma exacta
+        if ((emptyCount <= state.endgameEmpties) && (depth > ENDGAME_MIDGAME_DEPTH))
         {
-            GameModel nextModel = model;       // copia del estado
-            playMove(nextModel, move);         // aplica la jugada
-            int eval = minimax(nextModel, table, depth - 1,alpha,beta, false, maxPlayer);
-			if (eval > maxEval) maxEval = eval;
-			if (eval > alpha) alpha = eval; // actualiza alpha
-			if (beta <= alpha) break; // poda beta
+            int window = state.endgameWLD ? 1 : ENDGAME_SCORE_MAX;
+            int score = solveEndgame(state, table, -window, window, bestMove);
+
+            if (state.aborted)
+                break;
+
+            result.move = getIndexSquare(bestMove);
+            result.score = score;
+            result.depth = emptyCount;
+            result.solved = true;
+            recordSearchIteration(state.stats, emptyCount, state.stats.nodes - iterationNodes,
+                                  getSearchClock() - iterationStart);
+            break;
         }
-        return maxEval;
+
+        int score = (depth > ASPIRATION_MIN_DEPTH)
+                        ? searchAspirationWindow(state, table, depth, result.score, bestMove)
+                        : searchRoot(state, table, depth, -INF, INF, bestMove);
+
+        if (state.aborted)
+            break;
+
+        result.move = getIndexSquare(bestMove);
+        result.score = score;
+        result.depth = depth;
+        recordSearchIteration(state.stats, depth, state.stats.nodes - iterationNodes,
+                              getSearchClock() - iterationStart);
+
+        // Más profundo que las casillas libres no cambia el resultado
+        if (depth > emptyCount)
+            break;
+
+        // No empiezo una iteración que probablemente no termine
+        if ((limits.softTime > 0) && (getSearchClock() - startTime >= limits.softTime))
+            break;
+    }
+
+    result.stats = state.stats;
+}
+
+/**
+ * @brief A Lazy SMP helper: searches the same root as the main thread,
+ * starting one ply deeper on odd threads, until told to stop or the
+ * caller's depth is reached. Its only effect on the main search is through
+ * the shared transposition table.
+ */
+static void runHelperThread(AIEngine *engine, const GameModel *model, int firstDepth, int maxDepth, double deadline, const std::atomic<bool> *stop, SearchResult *result)
+{
+    SearchState state;
+    initSearchState(state, *engine, *model, deadline, stop);
+
+    // Capped at the caller's depth: deeper results would be taken over
+    SearchLimits limits;
+    limits.depth = maxDepth;
+    limits.softTime = 0;
+    limits.hardTime = 0;
+
+    iterateDeepening(state, engine->table, limits, firstDepth, 0, NULL, *result);
+}
+
+/**
+ * @brief Implements findBestMove(), optionally carrying on a search of the
+ * same position made while pondering.
+ *
+ * @param engine The engine.
+ * @param model The game model.
+ * @param limits The search limits.
+ * @param pondered The pondered search of the position, or NULL.
+ * @param result Receives the search outcome.
+ * @return The best move.
+ */
+static Square searchBestMove(AIEngine &engine, const GameModel &model, const SearchLimits &limits, const SearchResult *pondered, SearchResult &result)
+{
+    double startTime = getSearchClock();
+    double deadline = (limits.hardTime > 0) ? startTime + limits.hardTime : 0;
+
+    // Known openings are played without searching
+    Position position;
+    getPosition(model, position);
+
+    int bookMove;
+    int bookScore;
+    if (probeOpeningBook(engine.book, position, bookMove, bookScore))
+    {
+        memset(&result, 0, sizeof(result));
+        result.move = getIndexSquare(bookMove);
+        result.score = bookScore;
+        result.book = true;
+        result.time = getSearchClock() - startTime;
+
+        return result.move;
     }
-    else 
+
+    // A pondered search that already reached the end (or the depth limit)
+    // is played at once
+    int emptyCount = countBits(~(position.discs[PLAYER_BLACK] | position.discs[PLAYER_WHITE]));
+    if (pondered && (pondered->solved || (pondered->depth > emptyCount) || (pondered->depth >= limits.depth)))
     {
-        int minEval = INF;
-        for (const auto& move : validMoves) 
+        result = *pondered;
+        clearSearchStats(result.stats);
+        result.book = false;
+        result.pondered = true;
+        result.time = getSearchClock() - startTime;
+
+        return result.move;
+    }
+
+    // Otherwise it is carried on one ply deeper; its table entries are
+    // still current, so the table isn't aged for it
+    int firstDepth = pondered ? pondered->depth + 1 : 1;
+
+    TranspositionTable &table = engine.table;
+    if (!pondered)
+        ageTranspositionTable(table);
+
+    // Helper threads stop when the main thread is done
+    int helperCount = engine.config.threads - 1;
+    if (helperCount > SEARCH_MAX_THREADS - 1)
+        helperCount = SEARCH_MAX_THREADS - 1;
+
+    // Sized by the helpers in use: a SearchResult is too big to reserve
+    // SEARCH_MAX_THREADS of them on the stack
+    std::atomic<bool> helpersStop(false);
+    std::vector<std::thread> helpers(helperCount);
+    std::vector<SearchResult> helperResults(helperCount);
+
+    for (int i = 0; i < helperCount; i++)
+        helpers[i] = std::thread(runHelperThread, &engine, &model, firstDepth + ((i + 1) & 1), limits.depth, deadline, &helpersStop, &helperResults[i]);
+
+    SearchState state;
+    initSearchState(state, engine, model, deadline, &engine.stopSearch);
+
+    iterateDeepening(state, table, limits, firstDepth, startTime, pondered, result);
+
+    helpersStop = true;
+
+    // A helper may have completed a deeper iteration than the main thread
+    for (int i = 0; i < helperCount; i++)
+    {
+        helpers[i].join();
+
+        if ((helperResults[i].solved && !result.solved) ||
+            ((helperResults[i].solved == result.solved) && (helperResults[i].depth > result.depth)))
         {
-            GameModel nextModel = model;
-            playMove(nextModel, move);
-            int eval = minimax(nextModel, table, depth - 1,alpha,beta, true, maxPlayer);
-			if (eval < minEval) minEval = eval;
-			if (eval < beta) beta = eval; // actualiza beta
-			if (beta <= alpha) break; // poda alpha
+            result.move = helperResults[i].move;
+            result.score = helperResults[i].score;
+            result.depth = helperResults[i].depth;
+            result.solved = helperResults[i].solved;
         }
-        return minEval;
+        addSearchStats(result.stats, helperResults[i].stats);
     }
+
+    result.book = false;
+    result.pondered = (pondered != NULL);
+    result.time = getSearchClock() - startTime;
+
+    return result.move;
 }
 
+Square findBestMove(AIEngine& engine, const GameModel& model, const SearchLimits& limits, SearchResult& result)
+{
+    return searchBestMove(engine, model, limits, NULL, result);
+}
 
+/**
+ * @brief A pondering thread: deepens its share of the pondered replies in
+ * turn, one ply at a time, until all are finished or it is told to stop.
+ */
+static void runPonderThread(AIEngine *engine, int threadIndex, int threadCount)
+{
+    for (int depth = 1; depth <= engine->config.maxDepth; depth++)
+    {
+        bool searching = false;
 
+        for (int i = threadIndex; i < ponderLineCount; i += threadCount)
+        {
+            PonderLine &line = ponderLines[i];
+            int emptyCount = countBits(~(line.position.discs[PLAYER_BLACK] | line.position.discs[PLAYER_WHITE]));
 
+            if (line.result.solved || (line.result.depth > emptyCount))
+                continue;
+            searching = true;
 
-// Tabla de pesos estáticos para Reversi
-static const int POSITIONAL_WEIGHTS[BOARD_SIZE][BOARD_SIZE] = {
-    {120, -20, 20,  5,  5, 20, -20, 120},
-    {-20, -40, -5, -5, -5, -5, -40, -20},
-    { 20,  -5, 15,  3,  3, 15,  -5,  20},
-    {  5,  -5,  3,  3,  3,  3,  -5,   5},
-    {  5,  -5,  3,  3,  3,  3,  -5,   5},
-    { 20,  -5, 15,  3,  3, 15,  -5,  20},
-    {-20, -40, -5, -5, -5, -5, -40, -20},
-    {120, -20, 20,  5,  5, 20, -20, 120}
-};
+            GameModel model;
+            getPositionModel(line.position, model);
+
+            SearchState state;
+            initSearchState(state, *engine, model, 0, &ponderStop);
+
+            // One iteration: shallower ones are in the table already, and
+            // the last one's score centres the aspiration window
+            SearchLimits limits;
+            limits.depth = depth;
+            limits.softTime = 0;
+            limits.hardTime = 0;
+
+            SearchResult result;
+            iterateDeepening(state, engine->table, limits, depth, 0,
+                             line.result.depth ? &line.result : NULL, result);
+            if (ponderStop)
+                return;
 
-// Esto es una porqueria hay que cambiarlo
-inline Piece playerToPiece(Player p) {
-    return (p == PLAYER_BLACK) ? PIECE_BLACK : PIECE_WHITE;
+            result.book = false;
+            result.pondered = true;
+            line.result = result;
+        }
+
+        if (!searching)
+            return;
+    }
 }
 
-inline Piece opponentPiece(Player p) {
-    return (p == PLAYER_BLACK) ? PIECE_WHITE : PIECE_BLACK;
+void startPondering(const GameModel &model)
+{
+    cancelBestMoveSearch();
+
+    AIEngine &engine = getDefaultEngine();
+
+    Position position;
+    getPosition(model, position);
+
+    // Replies that end the game or make us pass need no search of ours
+    ponderLineCount = 0;
+    for (Bitboard moves = getPositionMoves(position); moves; moves &= moves - 1)
+    {
+        PonderLine &line = ponderLines[ponderLineCount];
+        MoveUndo undo;
+
+        line.position = position;
+        applyMove(line.position, getFirstBit(moves), undo);
+        if (line.position.gameOver || (line.position.currentPlayer == position.currentPlayer))
+            continue;
+
+        memset(&line.result, 0, sizeof(line.result));
+        ponderLineCount++;
+    }
+
+    // A new search: the entries of earlier moves give way first
+    ageTranspositionTable(engine.table);
+
+    ponderThreadCount = engine.config.threads;
+    if (ponderThreadCount > ponderLineCount)
+        ponderThreadCount = ponderLineCount;
+
+    ponderStop = false;
+    for (int i = 0; i < ponderThreadCount; i++)
+        ponderThreads[i] = std::thread(runPonderThread, &engine, i, ponderThreadCount);
+
+    pondering = true;
 }
 
-int evaluateBoard(const Board board, Player maxPlayer)
+bool isPondering()
 {
-    //Cuento la cantidad de nodos explorados
-    exploratedNodes++;
+    return pondering;
+}
 
-    // Convierto el jugador en pieza
-    Piece myPiece = playerToPiece(maxPlayer);
-    Piece oppPiece = opponentPiece(maxPlayer);
+void stopPondering()
+{
+    ponderStop = true;
+    for (int i = 0; i < ponderThreadCount; i++)
+        ponderThreads[i].join();
 
-    // Matricas basicas
-    int myDiscs = 0, oppDiscs = 0;         // Cantidad de fichas propias y del rival
-    int myScorePos = 0, oppScorePos = 0;   // Suma de los valores de la tabla de posiciones
-    int myFrontier = 0, oppFrontier = 0;   // Cantidad de fichas adyacentes a casillas vacías
-    int emptyCount = 0;                    // Cuántos espacios vacíos quedan en el tablero
-
-    // Direcciones posibles (8 alrededor de una casilla)
-    const int dx[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
-    const int dy[8] = { -1,  0,  1,-1, 1,-1, 0, 1 };
-
-    // Recorro todo el tablero
-    for (int x = 0; x < BOARD_SIZE; x++) {
-        for (int y = 0; y < BOARD_SIZE; y++) {
-            Piece piece = board[y][x];
-
-            // Si la casilla está vacia
-            if (piece == PIECE_EMPTY) {
-                emptyCount++;
-                continue;
-            }
+    ponderThreadCount = 0;
+    pondering = false;
+}
 
-            // Si es mi ficha
-            if (piece == myPiece) {
-                myDiscs++;                            // Sumo a mis fichas
-                myScorePos += POSITIONAL_WEIGHTS[x][y]; // Sumo el valor posicional
-
-                // Verifico si está en la frontera (adyacente a un casillero vacio)
-                for (int k = 0; k < 8; k++) {
-                    int nx = x + dx[k], ny = y + dy[k];
-                    if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE &&
-                        board[ny][nx] == PIECE_EMPTY) {
-                        myFrontier++;
-                        break; // Si encuentro un vacío salgo
-                    }
-                }
-            }
+std::string getSearchResultJson(const SearchResult &result)
+{
+    char move[8];
+    if (result.move.x < 0)
+        snprintf(move, sizeof(move), "pass");
+    else
+        snprintf(move, sizeof(move), "%c%c", 'a' + result.move.x, '1' + result.move.y);
+
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer),
+             "{\"move\":\"%s\",\"score\":%d,\"depth\":%d,\"solved\":%s,\"book\":%s,\"pondered\":%s,\"time\":%.6f",
+             move, result.score, result.depth,
+             result.solved ? "true" : "false", result.book ? "true" : "false",
+             result.pondered ? "true" : "false", result.time);
+
+    std::string json = buffer;
+    appendSearchStatsJson(json, result.stats, result.time);
+    json += "}";
+
+    return json;
+}
+
+// Negamax con búsqueda de variante principal (PVS): los valores son siempre
+// relativos al jugador que mueve. La primera jugada se busca con la ventana
+// completa y las demás con ventana nula, re-buscando si la superan.
+int negamax(SearchState& state, TranspositionTable& table, int depth, int alpha, int beta)
+{
+    const Position &position = state.position;
+
+    if (isSearchAborted(state))
+        return 0;
+
+    // Caso base
+    if (depth == 0 || state.ply >= SEARCH_MAX_PLY) 
+    {
+        state.stats.leaves++;
+        return evaluateSearchPosition(state);
+    }
 
-            // Si es ficha del rival
-            else if (piece == oppPiece) {
-                oppDiscs++;                             // Sumo a las fichas del rival
-                oppScorePos += POSITIONAL_WEIGHTS[x][y]; // Sumo el valor posicional
-
-                // Verifico si esta en la frontera
-                for (int k = 0; k < 8; k++) {
-                    int nx = x + dx[k], ny = y + dy[k];
-                    if (nx >= 0 && nx < BOARD_SIZE && ny >= 0 && ny < BOARD_SIZE &&
-                        board[ny][nx] == PIECE_EMPTY) {
-                        oppFrontier++;
-                        break;
-                    }
-                }
+    // Consulto la tabla de transposición
+    NodePunctuation node;
+    int hashMove = -1;
+    if (probeSearchResult(state, table, node))
+    {
+        hashMove = node.move;
+
+        if (node.depth >= depth)
+        {
+            if (node.bound == EXACT)
+            {
+                state.stats.tableCutoffs++;
+                return node.eval;
             }
+            if (node.bound == LOWER_BOUND && node.eval > alpha)
+                alpha = node.eval;
+            if (node.bound == UPPER_BOUND && node.eval < beta)
+                beta = node.eval;
+            if (alpha >= beta)
+            {
+                state.stats.tableCutoffs++;
+                return node.eval;
+            }
+        }
+    }
+
+    Bitboard validMoves = getPositionMoves(position);
+
+    if (!validMoves) 
+    {
+        // Si ninguno de los dos puede jugar, termina el juego: el resultado es exacto
+        if (!getMovesBitboard(position.discs[position.currentPlayer ^ 1], position.discs[position.currentPlayer]))
+        {
+            state.stats.leaves++;
+
+            int score = getFinalScore(position.discs[position.currentPlayer],
+                                      position.discs[position.currentPlayer ^ 1]);
+            return (score > 0) ? WIN_SCORE + score : (score < 0) ? -WIN_SCORE + score : 0;
+        }
+
+        // Si no hay jugadas válidas, el jugador pasa turno automáticamente
+        playSearchMove(state, -1);
+        int eval = -negamax(state, table, depth - 1, -beta, -alpha);
+        undoSearchMove(state);
+        return eval;
+    }
+
+    int moves[BOARD_SIZE * BOARD_SIZE];
+    int priorities[BOARD_SIZE * BOARD_SIZE];
+    int moveCount = orderMoves(state, validMoves, hashMove, moves, priorities);
+
+    if (state.shallowOrdering && (depth >= SHALLOW_ORDERING_MIN_DEPTH))
+        orderMovesByShallowSearch(state, table, moves, priorities, moveCount,
+                                  priorities[0] == HASH_MOVE_PRIORITY);
+
+    int originalAlpha = alpha;
+    int bestEval = -INF;
+    int bestMove = -1;
+
+    for (int i = 0; i < moveCount; i++) 
+    {
+        int eval;
+
+        playSearchMove(state, moves[i]); // aplica la jugada
+        if (i == 0)
+            eval = -negamax(state, table, depth - 1, -beta, -alpha);
+        else
+        {
+            // Ventana nula: solo pregunto si la jugada supera alpha
+            eval = -negamax(state, table, depth - 1, -alpha - 1, -alpha);
+            if ((eval > alpha) && (eval < beta))
+                eval = -negamax(state, table, depth - 1, -beta, -alpha);
+        }
+        undoSearchMove(state);           // deshace la jugada
+
+        if (state.aborted)
+            return 0;
+
+        if (eval > bestEval)
+        {
+            bestEval = eval;
+            bestMove = moves[i];
+        }
+        if (eval > alpha)
+            alpha = eval;
+        if (alpha >= beta)
+        {
+            recordCutoff(state, moves[i], i, depth); // poda
+            break;
         }
     }
 
+    storeSearchResult(state, table, depth, bestEval, originalAlpha, beta, bestMove);
+
+    return bestEval;
+}
+
+/**
+ * @brief Returns the weights of the default weight file, mapped on first
+ * use; the default engine (and its table) isn't needed to evaluate.
+ */
+static const PatternWeights &getDefaultWeights()
+{
+    // Function-local static: initialised once, even across threads
+    static const PatternWeights weights = []()
+    {
+        PatternWeights loaded = PatternWeights();
+        loadPatternWeights(loaded, DEFAULT_WEIGHTS_PATH);
+        return loaded;
+    }();
+
+    return weights;
+}
+
+int evaluateBoard(const Board board, Player maxPlayer)
+{
+    GameModel model;
+    memcpy(model.board, board, sizeof(model.board));
+    model.currentPlayer = maxPlayer;
+    model.gameOver = false;
+
+    Position position;
+    getPosition(model, position);
+
+    return evaluatePosition(position, maxPlayer, &getDefaultWeights());
+}
+
+void getEvalState(const Position &position, EvalState &eval)
+{
+    for (int player = PLAYER_BLACK; player <= PLAYER_WHITE; player++)
+    {
+        eval.discs[player] = countBits(position.discs[player]);
+
+        // Suma de los valores de la tabla de posiciones
+        eval.positional[player] = 0;
+        for (Bitboard discs = position.discs[player]; discs; discs &= discs - 1)
+            eval.positional[player] += getSquareWeight(getFirstBit(discs));
+    }
+
+    getPatternIndices(position, eval.patterns);
+}
+
+int evaluatePosition(const Position &position, Player maxPlayer, const PatternWeights *weights)
+{
+    EvalState eval;
+    getEvalState(position, eval);
+
+    if (weights && weights->weights)
+        return evaluatePatterns(*weights, eval.patterns, eval.discs[0] + eval.discs[1], maxPlayer);
+
+    return evaluateTerms(position, eval, maxPlayer);
+}
+
+int evaluateSearchPosition(const SearchState &state)
+{
+    const EvalState &eval = state.eval;
+    Player player = state.position.currentPlayer;
+
+    if (state.weights->weights)
+        return evaluatePatterns(*state.weights, eval.patterns, eval.discs[0] + eval.discs[1], player);
+
+    return evaluateTerms(state.position, eval, player);
+}
+
+/**
+ * @brief Evaluates a position from its incrementally kept terms plus
+ * mobility and frontier, which are computed on the bitboards.
+ */
+static int evaluateTerms(const Position &position, const EvalState &eval, Player maxPlayer)
+{
+    Bitboard mine = position.discs[maxPlayer];
+    Bitboard theirs = position.discs[maxPlayer ^ 1];
+    Bitboard empty = ~(mine | theirs);
+
+    // Matricas basicas
+    int myDiscs = eval.discs[maxPlayer];             // Cantidad de fichas propias
+    int oppDiscs = eval.discs[maxPlayer ^ 1];        // Cantidad de fichas del rival
+    int emptyCount = BOARD_SIZE * BOARD_SIZE - myDiscs - oppDiscs; // Cuántos espacios vacíos quedan
+
+    int myScorePos = eval.positional[maxPlayer];     // Suma de los valores de la tabla de posiciones
+    int oppScorePos = eval.positional[maxPlayer ^ 1];
+
+    // Fichas en la frontera (adyacentes a un casillero vacio)
+    Bitboard emptyAdjacent = getAdjacentBitboard(empty);
+    int myFrontier = countBits(mine & emptyAdjacent);
+    int oppFrontier = countBits(theirs & emptyAdjacent);
+
+    // Fichas estables (no se pueden voltear nunca)
+    int myStable = getStableCount(mine, theirs);
+    int oppStable = getStableCount(theirs, mine);
+
 
     // Normalización de métricas
 
@@ -211,8 +1225,8 @@ int evaluateBoard(const Board board, Player maxPlayer)
         : 0.0;
 
     // Movilidad (quién tiene más movimientos legales disponibles)
-    int myMoves = getValidMovesNumber(board, maxPlayer);
-    int oppMoves = getValidMovesNumber(board, (maxPlayer == PLAYER_BLACK) ? PLAYER_WHITE : PLAYER_BLACK);
+    int myMoves = countBits(getMovesBitboard(mine, theirs));
+    int oppMoves = countBits(getMovesBitboard(theirs, mine));
     double mobility = (myMoves + oppMoves > 0)
         ? (double)(myMoves - oppMoves) / (myMoves + oppMoves)
         : 0.0;
@@ -222,19 +1236,24 @@ int evaluateBoard(const Board board, Player maxPlayer)
         ? -(double)(myFrontier - oppFrontier) / (myFrontier + oppFrontier)
         : 0.0;
 
+    // Estabilidad (ventaja permanente)
+    double stability = (myStable + oppStable > 0)
+        ? (double)(myStable - oppStable) / (myStable + oppStable)
+        : 0.0;
+
     // Puntaje posicional (normalizado por el máximo absoluto posible 7680 = 64 * 120)
     double positional = (double)(myScorePos - oppScorePos) / 7680.0;
 
     // Evaluación según etapa del juego
     double score = 0.0;
     if (emptyCount > 44) { // early game (muchos espacios vacíos todavía)
-        score = 0.1 * parity + 0.8 * mobility + 0.3 * frontier + 1.0 * positional;
+        score = 0.1 * parity + 0.8 * mobility + 0.5 * stability + 0.3 * frontier + 1.0 * positional;
     }
     else if (emptyCount > 20) { // mid game
-        score = 0.1 * parity + 0.7 * mobility + 0.5 * frontier + 0.5 * positional;
+        score = 0.1 * parity + 0.7 * mobility + 1.0 * stability + 0.5 * frontier + 0.5 * positional;
     }
     else { // late game (quedan pocas casillas)
-        score = 1.0 * parity + 0.1 * mobility + 0.2 * frontier + 0.1 * positional;
+        score = 1.0 * parity + 0.1 * mobility + 2.0 * stability + 0.2 * frontier + 0.1 * positional;
     }
 
     // Escalo el score a un rango legible [-100, 100]
@@ -8,27 +8,153 @@
 #ifndef AI_H
 #define AI_H
 
+#include <atomic>
+
 #include "model.h"
-#include <unordered_map>
+#include "book.h"
+#include "pattern.h"
+#include "searchstats.h"
+#include "transposition.h"
+
+#define SEARCH_MAX_PLY 128
+#define SEARCH_MAX_DEPTH 64
+#define SEARCH_MAX_THREADS 256
+
+/**
+ * @brief Evaluation terms kept up to date as the search plays and takes back
+ * moves, instead of rescanning the board at every leaf.
+ */
+struct EvalState
+{
+	int discs[2];       // Disc count per player
+	int positional[2];  // Sum of the static square weights per player
+	PatternIndices patterns;
+};
 
-enum Bound
+/**
+ * @brief Mutable search position with its stack of undo records.
+ */
+struct SearchState
 {
-	EXACT,
-	LOWER_BOUND,
-	UPPER_BOUND
+	Position position;
+	EvalState eval;
+	const PatternWeights *weights; // Pattern evaluation, if loaded
+
+	MoveUndo undoStack[SEARCH_MAX_PLY];
+	EvalState evalStack[SEARCH_MAX_PLY];
+	int ply;
+
+	int killers[SEARCH_MAX_PLY][2];              // Last two cutoff moves per ply
+	int history[2][BOARD_SIZE * BOARD_SIZE];     // Cutoff scores per player and square
+	bool shallowOrdering;
+	bool canonicalHashing;
+	int endgameEmpties;
+	bool endgameWLD;
+
+	SearchStats stats;
+	double deadline;     // Abort time (search clock), 0 for none
+	const std::atomic<bool> *stop; // Abort request from another thread
+	bool aborted;
 };
 
-struct NodePunctuation
+/**
+ * @brief Depth and time limits of one search.
+ */
+struct SearchLimits
 {
-	int eval;
-	Bound bound;
 	int depth;
+	double softTime;     // Seconds after which no new iteration starts, 0 for none
+	double hardTime;     // Seconds after which the search is aborted, 0 for none
 };
 
-typedef std::unordered_map<uint64_t, NodePunctuation> NodesTable; // Keys are Zobrist hash
+/**
+ * @brief Outcome of one search.
+ */
+struct SearchResult
+{
+	Square move;
+	int score;
+	int depth;           // Last completed iteration
+	bool solved;         // Solved to the end: score is the final disc differential
+	bool book;           // Taken from the opening book, without searching
+	bool pondered;       // Found, or started, on the opponent's time
+	SearchStats stats;   // Counters summed over all search threads
+	double time;         // Seconds
+};
 
 /**
- * @brief Returns the best move for a certain position.
+ * @brief AI settings.
+ */
+struct AIConfig
+{
+	size_t tableSizeMB;  // Transposition table size
+	bool hugePages;      // Back the transposition table with huge pages
+
+	int threads;         // Search threads (Lazy SMP)
+
+	bool shallowOrdering; // Order moves at deep interior nodes by a shallow search
+	bool canonicalHashing; // Share table entries between symmetric positions
+
+	int endgameEmpties;  // Solve exactly from this many empty squares
+	bool endgameWLD;     // Solve for win/loss/draw only
+
+	int maxDepth;        // Iterative deepening limit
+	double moveTime;     // Seconds per move, 0 to derive it from gameTime
+	double gameTime;     // Seconds per game, 0 for no time limit
+
+	const char *weightsPath; // Pattern weight file, NULL for the built-in evaluation
+	const char *bookPath;    // Opening book file, NULL for none
+};
+
+/**
+ * @brief An AI player: its settings and the state it keeps between moves.
+ */
+struct AIEngine
+{
+	AIConfig config;
+
+	TranspositionTable table;
+	PatternWeights weights;
+	OpeningBook book;
+
+	std::atomic<bool> stopSearch; // Set to make a running search return
+};
+
+/**
+ * @brief Fills an AI configuration with the default settings.
+ *
+ * @param config The configuration.
+ */
+void getDefaultAIConfig(AIConfig &config);
+
+/**
+ * @brief Initializes an AI engine, allocating its transposition table.
+ *
+ * @param engine The engine.
+ * @param config The settings.
+ */
+void initAIEngine(AIEngine &engine, const AIConfig &config);
+
+/**
+ * @brief Frees an AI engine.
+ *
+ * @param engine The engine.
+ */
+void freeAIEngine(AIEngine &engine);
+
+/**
+ * @brief Computes the limits of the next search from the engine settings and
+ * the time the player to move has already used.
+ *
+ * @param engine The engine.
+ * @param model The game model.
+ * @param limits Receives the limits.
+ */
+void getSearchLimits(const AIEngine &engine, const GameModel &model, SearchLimits &limits);
+
+/**
+ * @brief Returns the best move for a certain position, using the default
+ * engine (created on first use and kept between moves).
  *
  * @return The best move.
  */
@@ -36,7 +162,128 @@ Square getBestMove(GameModel &model);
 
 int evaluateBoard(const Board board, Player maxPlayer);
 
-Square findBestMove(const GameModel& model, int depth);
-int minimax(const GameModel& model, NodesTable& table, int depth, int alpha, int beta, bool maximizingPlayer, Player maxPlayer);
+/**
+ * @brief Evaluates a bitboard position.
+ *
+ * @param position The position.
+ * @param maxPlayer The player the score is relative to.
+ * @param weights Pattern weights, or NULL for the built-in evaluation.
+ * @return The score (positive is good for maxPlayer).
+ */
+int evaluatePosition(const Position &position, Player maxPlayer, const PatternWeights *weights);
+
+/**
+ * @brief Computes the incremental evaluation terms of a position from scratch.
+ *
+ * @param position The position.
+ * @param eval Receives the terms.
+ */
+void getEvalState(const Position &position, EvalState &eval);
+
+/**
+ * @brief Evaluates the search position using its incremental terms.
+ *
+ * @param state The search state.
+ * @return The score, relative to the player to move.
+ */
+int evaluateSearchPosition(const SearchState &state);
+
+
+/**
+ * @brief Starts searching the best move on a background thread, using the
+ * default engine. Any running search is cancelled first.
+ *
+ * @param model The game model (copied, so it may change during the search).
+ */
+void startBestMoveSearch(const GameModel &model);
+
+/**
+ * @brief Checks whether the background search has finished.
+ *
+ * @param move Receives the best move once the search has finished.
+ * @param result Receives the search outcome once the search has finished.
+ * @return Whether the search has finished (the job is then released).
+ */
+bool pollBestMoveSearch(Square &move, SearchResult &result);
+
+/**
+ * @brief Indicates whether a background search was started and not yet
+ * polled or cancelled.
+ *
+ * @return true or false.
+ */
+bool isBestMoveSearchRunning();
+
+/**
+ * @brief Stops the background search and pondering, if any, and waits for
+ * them to return.
+ */
+void cancelBestMoveSearch();
+
+/**
+ * @brief Starts pondering on background threads while the opponent is to
+ * move: every reply is searched, deeper and deeper, with the default
+ * engine. The next startBestMoveSearch() carries on the search of the reply
+ * actually played, or plays its result at once if it is finished. Any
+ * running search is cancelled first.
+ *
+ * @param model The game model, with the opponent to move.
+ */
+void startPondering(const GameModel &model);
+
+/**
+ * @brief Indicates whether pondering was started and not yet stopped.
+ *
+ * @return true or false.
+ */
+bool isPondering();
+
+/**
+ * @brief Stops pondering, if running, and waits for its threads to return.
+ * The pondered results are kept for the next search.
+ */
+void stopPondering();
+
+/**
+ * @brief Searches a position by iterative deepening until a limit is hit,
+ * keeping the best move of the last completed iteration. Positions in the
+ * engine's opening book are answered from it without searching.
+ *
+ * @param engine The engine.
+ * @param model The game model.
+ * @param limits The search limits.
+ * @param result Receives the search outcome.
+ * @return The best move (GAME_INVALID_SQUARE if there are no moves).
+ */
+Square findBestMove(AIEngine& engine, const GameModel& model, const SearchLimits& limits, SearchResult& result);
+
+/**
+ * @brief Formats a search outcome and its statistics as one line of JSON.
+ *
+ * @param result The search outcome.
+ * @return The JSON object, without a line break.
+ */
+std::string getSearchResultJson(const SearchResult &result);
+
+/**
+ * @brief Counts a search node and, every few nodes, checks the deadline and
+ * the stop request.
+ *
+ * @param state The search state.
+ * @return Whether the search must stop.
+ */
+bool isSearchAborted(SearchState &state);
+
+/**
+ * @brief Negamax principal variation search with alpha-beta pruning.
+ *
+ * @param state The search state.
+ * @param table The transposition table.
+ * @param depth The remaining depth.
+ * @param alpha The lower bound of the search window.
+ * @param beta The upper bound of the search window.
+ * @return The score, relative to the player to move.
+ */
+int negamax(SearchState& state, TranspositionTable& table, int depth, int alpha, int beta);
 
 #endif
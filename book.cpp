@@ -0,0 +1,147 @@
+/**
+ * @brief Implements the opening book of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "book.h"
+
+/**
+ * @brief Orders records by position, the order of a book file.
+ */
+static bool isRecordBefore(const BookRecord &a, const BookRecord &b)
+{
+    if (a.player != b.player)
+        return a.player < b.player;
+
+    return a.opponent < b.opponent;
+}
+
+bool loadOpeningBook(OpeningBook &book, const char *path)
+{
+    book.records = NULL;
+    book.recordCount = 0;
+
+    if (!openMappedFile(book.file, path))
+        return false;
+
+    const BookFileHeader *header = (const BookFileHeader *)book.file.data;
+
+    if ((book.file.size < sizeof(BookFileHeader)) ||
+        memcmp(header->magic, BOOK_FILE_MAGIC, sizeof(header->magic)) ||
+        (header->version != BOOK_FILE_VERSION) ||
+        (header->recordSize != sizeof(BookRecord)) ||
+        (book.file.size != sizeof(BookFileHeader) + header->recordCount * sizeof(BookRecord)))
+    {
+        std::cerr << "Invalid opening book file: " << path << std::endl;
+        closeMappedFile(book.file);
+        return false;
+    }
+
+    book.records = (const BookRecord *)(header + 1);
+    book.recordCount = header->recordCount;
+
+    return true;
+}
+
+void freeOpeningBook(OpeningBook &book)
+{
+    closeMappedFile(book.file);
+    book.records = NULL;
+    book.recordCount = 0;
+}
+
+int getBookKey(Bitboard player, Bitboard opponent, BookRecord &record)
+{
+    int keySymmetry = 0;
+    record.player = player;
+    record.opponent = opponent;
+
+    for (int symmetry = 1; symmetry < SYMMETRY_COUNT; symmetry++)
+    {
+        BookRecord candidate;
+        candidate.player = getSymmetricBitboard(player, symmetry);
+        candidate.opponent = getSymmetricBitboard(opponent, symmetry);
+
+        if (isRecordBefore(candidate, record))
+        {
+            record.player = candidate.player;
+            record.opponent = candidate.opponent;
+            keySymmetry = symmetry;
+        }
+    }
+
+    return keySymmetry;
+}
+
+bool probeOpeningBook(const OpeningBook &book, const Position &position, int &move, int &score)
+{
+    if (!book.records || position.gameOver)
+        return false;
+
+    Bitboard player = position.discs[position.currentPlayer];
+    Bitboard opponent = position.discs[position.currentPlayer ^ 1];
+
+    BookRecord key;
+    int symmetry = getBookKey(player, opponent, key);
+
+    const BookRecord *end = book.records + book.recordCount;
+    const BookRecord *record = std::lower_bound(book.records, end, key, isRecordBefore);
+    if ((record == end) || (record->player != key.player) || (record->opponent != key.opponent))
+        return false;
+
+    // A corrupt file is a miss, not a move off the board
+    if (record->move >= BOARD_SIZE * BOARD_SIZE)
+        return false;
+
+    // Back from the key orientation to the position's; an illegal move is a miss too
+    int bookMove = getSymmetricSquare(record->move, getInverseSymmetry(symmetry));
+    if (!((getMovesBitboard(player, opponent) >> bookMove) & 1))
+        return false;
+
+    move = bookMove;
+    score = record->score;
+
+    return true;
+}
+
+bool saveOpeningBook(const char *path, std::vector<BookRecord> &records)
+{
+    std::sort(records.begin(), records.end(), isRecordBefore);
+
+    // Keep the deepest record of each position
+    size_t count = 0;
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        if (count && !isRecordBefore(records[count - 1], records[i]))
+        {
+            if (records[i].depth > records[count - 1].depth)
+                records[count - 1] = records[i];
+        }
+        else
+            records[count++] = records[i];
+    }
+    records.resize(count);
+
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    BookFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BOOK_FILE_MAGIC, sizeof(header.magic));
+    header.version = BOOK_FILE_VERSION;
+    header.recordSize = sizeof(BookRecord);
+    header.recordCount = count;
+
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                   (!count || (fwrite(&records[0], sizeof(BookRecord), count, file) == count));
+
+    return (fclose(file) == 0) && written;
+}
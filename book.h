@@ -0,0 +1,106 @@
+/**
+ * @brief Implements the opening book of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "mappedfile.h"
+#include "model.h"
+
+#define BOOK_FILE_MAGIC "EDABOOK"
+#define BOOK_FILE_VERSION 1
+
+/**
+ * @brief Header of an opening book file. It is followed by recordCount
+ * little-endian records, sorted by position.
+ */
+struct BookFileHeader
+{
+	char magic[8];          // BOOK_FILE_MAGIC
+	uint32_t version;       // BOOK_FILE_VERSION
+	uint32_t recordSize;    // sizeof(BookRecord)
+	uint64_t recordCount;
+};
+
+/**
+ * @brief A book position with its move. Positions are stored in the one of
+ * their 8 symmetric orientations that sorts first, so every orientation
+ * shares a record.
+ */
+struct BookRecord
+{
+	Bitboard player;        // Discs of the player to move
+	Bitboard opponent;
+	int16_t score;          // Relative to the player to move
+	uint8_t move;           // Square index, in the stored orientation
+	uint8_t depth;          // Search depth behind the score
+	uint32_t reserved;
+};
+
+/**
+ * @brief An opening book mapped from a book file.
+ */
+struct OpeningBook
+{
+	const BookRecord *records; // NULL if not loaded
+	uint64_t recordCount;
+
+	MappedFile file;
+};
+
+/**
+ * @brief Loads an opening book file.
+ *
+ * @param book The book, left unloaded on failure.
+ * @param path The file path.
+ * @return true if the file was loaded, false if it is missing or invalid.
+ */
+bool loadOpeningBook(OpeningBook &book, const char *path);
+
+/**
+ * @brief Releases a loaded opening book.
+ *
+ * @param book The book.
+ */
+void freeOpeningBook(OpeningBook &book);
+
+/**
+ * @brief Brings a position to the orientation used as book key.
+ *
+ * @param player The discs of the player to move.
+ * @param opponent The discs of the opponent.
+ * @param record Receives the key (player and opponent).
+ * @return The symmetry that maps the position onto the key.
+ */
+int getBookKey(Bitboard player, Bitboard opponent, BookRecord &record);
+
+/**
+ * @brief Looks a position up in the opening book.
+ *
+ * @param book The book.
+ * @param position The position.
+ * @param move Receives the book move's square index, in the position's
+ * orientation.
+ * @param score Receives the book score, relative to the player to move.
+ * @return true if the position is in the book with a legal move.
+ */
+bool probeOpeningBook(const OpeningBook &book, const Position &position, int &move, int &score);
+
+/**
+ * @brief Writes a book file. Records are sorted, and for repeated keys the
+ * deepest one is kept.
+ *
+ * @param path The file path.
+ * @param records The records, already in key orientation. Sorted in place.
+ * @return true on success.
+ */
+bool saveOpeningBook(const char *path, std::vector<BookRecord> &records);
+
+#endif
@@ -14,12 +14,13 @@
 #include "view.h"
 #include "controller.h"
 
-extern unsigned int exploratedNodes;
-
 bool updateView(GameModel &model)
 {
     if (WindowShouldClose())
+    {
+        cancelBestMoveSearch();
         return false;
+    }
 
     if (model.gameOver)
     {
@@ -29,18 +30,24 @@ bool updateView(GameModel &model)
             {
                 model.humanPlayer = PLAYER_BLACK;
 
+                cancelBestMoveSearch();
                 startModel(model);
             }
             else if (isMousePointerOverPlayWhiteButton())
             {
                 model.humanPlayer = PLAYER_WHITE;
 
+                cancelBestMoveSearch();
                 startModel(model);
             }
         }
     }
     else if (model.currentPlayer == model.humanPlayer)
     {
+        // The AI searches its replies on the human's time
+        if (!isPondering())
+            startPondering(model);
+
         if (IsMouseButtonPressed(0))
         {
             // Human player
@@ -48,7 +55,7 @@ bool updateView(GameModel &model)
 
             if (isSquareValid(square))
             {
-                Moves validMoves;
+                MoveList validMoves;
                 getValidMoves(model, validMoves);
 
                 // Play move if valid
@@ -56,19 +63,28 @@ bool updateView(GameModel &model)
                 {
                     if ((square.x == move.x) &&
                         (square.y == move.y))
+                    {
+                        stopPondering();
                         playMove(model, square);
+                    }
                 }
             }
         }
     }
     else
     {
-        // AI player
-        exploratedNodes = 0;
-        Square square = getBestMove(model);
-        std::cout << "Evaluacion del tablero (Jugador Humano): " << evaluateBoard(model.board, model.humanPlayer) << std::endl;
-        std::cout << "Cantidad de nodos explorados: " << exploratedNodes << std::endl << std::endl;
-        playMove(model, square);
+        // AI player: searched on a background thread so drawing never blocks
+        Square square;
+        SearchResult result;
+
+        if (!isBestMoveSearchRunning())
+            startBestMoveSearch(model);
+        else if (pollBestMoveSearch(square, result))
+        {
+            // One line of search statistics per move
+            std::cout << getSearchResultJson(result) << std::endl;
+            playMove(model, square);
+        }
     }
 
     if ((IsKeyDown(KEY_LEFT_ALT) ||
@@ -0,0 +1,356 @@
+/**
+ * @brief Implements the exact endgame solver of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include "endgame.h"
+#include "stability.h"
+
+#define ENDGAME_HASH_KEY 0x656e6467616d65ULL
+
+// Below these numbers of empty squares the solver skips the transposition
+// table, and orders moves by parity only instead of fastest-first
+#define ENDGAME_TABLE_MIN_EMPTIES 8
+#define FASTEST_FIRST_MIN_EMPTIES 7
+
+// At or below this number of empty squares the specialised solver is used
+#define ENDGAME_SMALL_EMPTIES 4
+
+#define HASH_MOVE_PRIORITY (1 << 30)
+
+/**
+ * @brief The four board quadrants, used for parity ordering.
+ */
+static const Bitboard QUADRANTS[4] = {
+    0x000000000f0f0f0fULL,
+    0x00000000f0f0f0f0ULL,
+    0x0f0f0f0f00000000ULL,
+    0xf0f0f0f000000000ULL,
+};
+
+#define CORNERS 0x8100000000000081ULL
+
+int getFinalScore(Bitboard player, Bitboard opponent)
+{
+    int playerCount = countBits(player);
+    int opponentCount = countBits(opponent);
+    int emptyCount = BOARD_SIZE * BOARD_SIZE - playerCount - opponentCount;
+    int score = playerCount - opponentCount;
+
+    if (score > 0)
+        score += emptyCount;
+    else if (score < 0)
+        score -= emptyCount;
+
+    return score;
+}
+
+/**
+ * @brief Returns the empty squares lying in quadrants with an odd number of
+ * empty squares. Playing there first tends to leave the last move of each
+ * region to the player.
+ */
+static Bitboard getOddQuadrants(Bitboard empty)
+{
+    Bitboard odd = 0;
+
+    for (int i = 0; i < 4; i++)
+        if (countBits(empty & QUADRANTS[i]) & 1)
+            odd |= QUADRANTS[i];
+
+    return empty & odd;
+}
+
+/**
+ * @brief Hashes an endgame node. The solver works on (player, opponent)
+ * bitboards, so the position is hashed directly; the key is distinct from
+ * midgame Zobrist keys, whose scores use another scale.
+ */
+static uint64_t getEndgameHash(Bitboard player, Bitboard opponent)
+{
+    return getDiscsHash(player, opponent) ^ ENDGAME_HASH_KEY;
+}
+
+/**
+ * @brief Solves a position with one empty square.
+ */
+static int solveLast1(SearchState &state, Bitboard player, Bitboard opponent, int square)
+{
+    state.stats.nodes++;
+    state.stats.leaves++;
+
+    int score = 2 * countBits(player) - (BOARD_SIZE * BOARD_SIZE - 1);
+
+    Bitboard flips = getFlipsBitboard(player, opponent, square);
+    if (flips)
+        return score + 1 + 2 * countBits(flips);
+
+    flips = getFlipsBitboard(opponent, player, square);
+    if (flips)
+        return score - 1 - 2 * countBits(flips);
+
+    // Nobody can play: the empty square goes to the winner (no draw is
+    // possible with an odd number of discs)
+    return (score > 0) ? score + 1 : score - 1;
+}
+
+/**
+ * @brief Solves a position with two to four empty squares: no move
+ * generation, no transposition table, moves tried in parity order.
+ */
+static int solveSmall(SearchState &state, Bitboard player, Bitboard opponent, int alpha, int beta, int emptyCount, bool passed)
+{
+    Bitboard empty = ~(player | opponent);
+
+    if (emptyCount == 1)
+        return solveLast1(state, player, opponent, getFirstBit(empty));
+
+    state.stats.nodes++;
+
+    Bitboard odd = getOddQuadrants(empty);
+    Bitboard orderedEmpties[2] = {odd, empty ^ odd};
+
+    int bestScore = -ENDGAME_SCORE_MAX - 1;
+
+    for (int group = 0; group < 2; group++)
+        for (Bitboard squares = orderedEmpties[group]; squares; squares &= squares - 1)
+        {
+            int square = getFirstBit(squares);
+            Bitboard flips = getFlipsBitboard(player, opponent, square);
+            if (!flips)
+                continue;
+
+            int score = -solveSmall(state,
+                                    opponent ^ flips,
+                                    player ^ flips ^ (1ULL << square),
+                                    -beta, -alpha, emptyCount - 1, false);
+
+            if (score > bestScore)
+            {
+                bestScore = score;
+                if (score > alpha)
+                {
+                    alpha = score;
+                    if (alpha >= beta)
+                        return bestScore;
+                }
+            }
+        }
+
+    if (bestScore > -ENDGAME_SCORE_MAX - 1)
+        return bestScore;
+
+    // No move: pass, or the game is over if the opponent just passed
+    if (passed)
+    {
+        state.stats.leaves++;
+        return getFinalScore(player, opponent);
+    }
+
+    return -solveSmall(state, opponent, player, -beta, -alpha, emptyCount, true);
+}
+
+/**
+ * @brief Orders the moves of an endgame node: the stored best move first,
+ * then fastest-first (fewest opponent replies, corners preferred) with many
+ * empty squares, or by quadrant parity with few.
+ */
+static int orderEndgameMoves(Bitboard player, Bitboard opponent, Bitboard moves, int hashMove, int emptyCount, int orderedMoves[])
+{
+    Bitboard odd = getOddQuadrants(~(player | opponent));
+    int priorities[BOARD_SIZE * BOARD_SIZE];
+    int count = 0;
+
+    for (; moves; moves &= moves - 1)
+    {
+        int move = getFirstBit(moves);
+        Bitboard bit = 1ULL << move;
+        int priority;
+
+        if (move == hashMove)
+            priority = HASH_MOVE_PRIORITY;
+        else if (emptyCount >= FASTEST_FIRST_MIN_EMPTIES)
+        {
+            Bitboard flips = getFlipsBitboard(player, opponent, move);
+            int replies = countBits(getMovesBitboard(opponent ^ flips, player ^ flips ^ bit));
+
+            priority = -16 * replies;
+            if (bit & CORNERS)
+                priority += 8;
+            if (bit & odd)
+                priority += 2;
+        }
+        else
+            priority = (bit & odd) ? 1 : 0;
+
+        // Insertion sort, highest priority first
+        int i = count++;
+        for (; (i > 0) && (priorities[i - 1] < priority); i--)
+        {
+            orderedMoves[i] = orderedMoves[i - 1];
+            priorities[i] = priorities[i - 1];
+        }
+        orderedMoves[i] = move;
+        priorities[i] = priority;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Solves an endgame node with principal variation search.
+ *
+ * @param bestMove If not NULL, receives the best move.
+ */
+static int solveNode(SearchState &state, TranspositionTable &table, Bitboard player, Bitboard opponent, int alpha, int beta, int *bestMove)
+{
+    if (isSearchAborted(state))
+        return 0;
+
+    int emptyCount = BOARD_SIZE * BOARD_SIZE - countBits(player | opponent);
+
+    if ((emptyCount <= ENDGAME_SMALL_EMPTIES) && !bestMove)
+        return solveSmall(state, player, opponent, alpha, beta, emptyCount, false);
+
+    // Stable discs bound the final score: each one is kept by its owner.
+    // Only worth computing when the disc counts alone could prove a cutoff
+    if (!bestMove)
+    {
+        if (2 * countBits(opponent) >= ENDGAME_SCORE_MAX - alpha)
+        {
+            int upperBound = ENDGAME_SCORE_MAX - 2 * getStableCount(opponent, player);
+            if (upperBound <= alpha)
+                return upperBound;
+        }
+
+        if (2 * countBits(player) >= ENDGAME_SCORE_MAX + beta)
+        {
+            int lowerBound = 2 * getStableCount(player, opponent) - ENDGAME_SCORE_MAX;
+            if (lowerBound >= beta)
+                return lowerBound;
+        }
+    }
+
+    Bitboard moves = getMovesBitboard(player, opponent);
+
+    if (!moves)
+    {
+        if (bestMove)
+            *bestMove = -1;
+
+        if (!getMovesBitboard(opponent, player))
+        {
+            state.stats.leaves++;
+            return getFinalScore(player, opponent);
+        }
+
+        return -solveNode(state, table, opponent, player, -beta, -alpha, NULL);
+    }
+
+    // Transposition table
+    bool useTable = (emptyCount >= ENDGAME_TABLE_MIN_EMPTIES);
+    uint64_t hash = 0;
+    int hashMove = -1;
+
+    if (useTable)
+    {
+        hash = getEndgameHash(player, opponent);
+
+        NodePunctuation node;
+        state.stats.tableProbes++;
+        if (probeTranspositionTable(table, hash, node))
+        {
+            state.stats.tableHits++;
+            hashMove = node.move;
+
+            if (!bestMove && (node.depth >= emptyCount))
+            {
+                if (node.bound == EXACT)
+                {
+                    state.stats.tableCutoffs++;
+                    return node.eval;
+                }
+                if ((node.bound == LOWER_BOUND) && (node.eval > alpha))
+                    alpha = node.eval;
+                if ((node.bound == UPPER_BOUND) && (node.eval < beta))
+                    beta = node.eval;
+                if (alpha >= beta)
+                {
+                    state.stats.tableCutoffs++;
+                    return node.eval;
+                }
+            }
+        }
+    }
+
+    int orderedMoves[BOARD_SIZE * BOARD_SIZE];
+    int moveCount = orderEndgameMoves(player, opponent, moves, hashMove, emptyCount, orderedMoves);
+
+    int originalAlpha = alpha;
+    int bestScore = -ENDGAME_SCORE_MAX - 1;
+    int best = -1;
+
+    for (int i = 0; i < moveCount; i++)
+    {
+        int move = orderedMoves[i];
+        Bitboard flips = getFlipsBitboard(player, opponent, move);
+        Bitboard nextPlayer = opponent ^ flips;
+        Bitboard nextOpponent = player ^ flips ^ (1ULL << move);
+        int score;
+
+        if (i == 0)
+            score = -solveNode(state, table, nextPlayer, nextOpponent, -beta, -alpha, NULL);
+        else
+        {
+            score = -solveNode(state, table, nextPlayer, nextOpponent, -alpha - 1, -alpha, NULL);
+            if ((score > alpha) && (score < beta))
+                score = -solveNode(state, table, nextPlayer, nextOpponent, -beta, -alpha, NULL);
+        }
+
+        if (state.aborted)
+            return 0;
+
+        if (score > bestScore)
+        {
+            bestScore = score;
+            best = move;
+            if (score > alpha)
+            {
+                alpha = score;
+                if (alpha >= beta)
+                {
+                    recordSearchCutoff(state.stats, i);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (useTable)
+    {
+        NodePunctuation node;
+        node.bound = (bestScore <= originalAlpha) ? UPPER_BOUND : (bestScore >= beta) ? LOWER_BOUND : EXACT;
+        node.eval = bestScore;
+        node.depth = emptyCount;
+        node.move = best;
+
+        storeTranspositionTable(table, hash, node);
+    }
+
+    if (bestMove)
+        *bestMove = best;
+
+    return bestScore;
+}
+
+int solveEndgame(SearchState &state, TranspositionTable &table, int alpha, int beta, int &bestMove)
+{
+    const Position &position = state.position;
+
+    return solveNode(state, table,
+                     position.discs[position.currentPlayer],
+                     position.discs[position.currentPlayer ^ 1],
+                     alpha, beta, &bestMove);
+}
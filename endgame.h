@@ -0,0 +1,40 @@
+/**
+ * @brief Implements the exact endgame solver of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef ENDGAME_H
+#define ENDGAME_H
+
+#include "ai.h"
+
+#define ENDGAME_SCORE_MAX 64
+
+/**
+ * @brief Returns the final disc differential of a finished game, with the
+ * empty squares going to the winner.
+ *
+ * @param player The discs of the player the score is relative to.
+ * @param opponent The discs of the opponent.
+ * @return The disc differential.
+ */
+int getFinalScore(Bitboard player, Bitboard opponent);
+
+/**
+ * @brief Solves the search position exactly, playing to the end of the game.
+ * With the window (-1, 1) this is a win/loss/draw solve.
+ *
+ * @param state The search state, at the root.
+ * @param table The transposition table.
+ * @param alpha The lower bound of the search window.
+ * @param beta The upper bound of the search window.
+ * @param bestMove Receives the best move's square index (-1 if the player
+ * to move must pass).
+ * @return The final disc differential for the player to move (meaningless
+ * if the search was aborted).
+ */
+int solveEndgame(SearchState &state, TranspositionTable &table, int alpha, int beta, int &bestMove);
+
+#endif
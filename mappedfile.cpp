@@ -0,0 +1,83 @@
+/**
+ * @brief Implements read-only memory-mapped data files
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "mappedfile.h"
+
+bool openMappedFile(MappedFile &file, const char *path)
+{
+    file.data = NULL;
+    file.size = 0;
+    file.mapped = false;
+
+#if defined(_WIN32)
+    FILE *stream = fopen(path, "rb");
+    if (!stream)
+        return false;
+
+    fseek(stream, 0, SEEK_END);
+    long size = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+
+    if (size > 0)
+    {
+        void *data = malloc(size);
+        if (data && (fread(data, 1, size, stream) == (size_t)size))
+        {
+            file.data = data;
+            file.size = size;
+        }
+        else
+            free(data);
+    }
+    fclose(stream);
+#else
+    int descriptor = open(path, O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat fileStat;
+    if (!fstat(descriptor, &fileStat) && (fileStat.st_size > 0))
+    {
+        void *data = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+        if (data != MAP_FAILED)
+        {
+            file.data = data;
+            file.size = fileStat.st_size;
+            file.mapped = true;
+        }
+    }
+    close(descriptor);
+#endif
+
+    return file.data != NULL;
+}
+
+void closeMappedFile(MappedFile &file)
+{
+    if (file.data)
+    {
+#if defined(_WIN32)
+        free((void *)file.data);
+#else
+        munmap((void *)file.data, file.size);
+#endif
+    }
+
+    file.data = NULL;
+    file.size = 0;
+    file.mapped = false;
+}
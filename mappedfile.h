@@ -0,0 +1,41 @@
+/**
+ * @brief Implements read-only memory-mapped data files
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+/**
+ * @brief A data file mapped read-only, so processes using the same file
+ * share one page cache copy. Where mapping is not available the file is
+ * read into memory instead.
+ */
+struct MappedFile
+{
+	const void *data;  // NULL if not open
+	size_t size;
+	bool mapped;
+};
+
+/**
+ * @brief Maps a file read-only.
+ *
+ * @param file The mapped file, left closed on failure.
+ * @param path The file path.
+ * @return true if the file could be opened and is not empty.
+ */
+bool openMappedFile(MappedFile &file, const char *path);
+
+/**
+ * @brief Unmaps a file.
+ *
+ * @param file The mapped file.
+ */
+void closeMappedFile(MappedFile &file);
+
+#endif
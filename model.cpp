@@ -5,12 +5,23 @@
  * @copyright Copyright (c) 2023-2024
  */
 
+#include <cassert>
+#include <chrono>
 #include <cstring>
-
-#include "raylib.h"
+#include <initializer_list>
 
 #include "model.h"
 
+/**
+ * @brief Returns a monotonic time in seconds, for the player clocks.
+ */
+static double getClock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
 struct Direction
 {
     int x;
@@ -26,19 +37,69 @@ struct Direction
 #define RIGHT_DOWN Direction{1, -1}
 #define RIGTH Direction{1, 0}
 
+#define NOT_FILE_A 0xfefefefefefefefeULL
+#define NOT_FILE_H 0x7f7f7f7f7f7f7f7fULL
+
 /**
- * @brief Recursive function to try eating pieces in a given direction. Similar implementation to checkCurrentSquare().
- *
- * @param model The game model.
- * @param source Where the new piece was just placed
- * @param dir Direction to try eating
- * 
- * @return Wether any pieces were eaten (true) or not (false).
+ * @brief Shifts a bitboard one square in each of the eight directions, in the
+ * same order as the Direction constants. Discs leaving the board are dropped.
+ */
+#define SHIFT_UP_RIGHT(b) (((b) << 9) & NOT_FILE_A)
+#define SHIFT_UP(b) ((b) << 8)
+#define SHIFT_UP_LEFT(b) (((b) << 7) & NOT_FILE_H)
+#define SHIFT_LEFT(b) (((b) >> 1) & NOT_FILE_H)
+#define SHIFT_LEFT_DOWN(b) (((b) >> 9) & NOT_FILE_H)
+#define SHIFT_DOWN(b) ((b) >> 8)
+#define SHIFT_RIGHT_DOWN(b) (((b) >> 7) & NOT_FILE_A)
+#define SHIFT_RIGHT(b) (((b) << 1) & NOT_FILE_A)
+
+/**
+ * @brief Zobrist keys: one per player and square, the XOR of both players'
+ * keys per square (a flip), and one for white to move.
+ */
+static uint64_t zobristKeys[2][BOARD_SIZE * BOARD_SIZE];
+static uint64_t zobristFlipKeys[BOARD_SIZE * BOARD_SIZE];
+static uint64_t zobristPlayerKey;
+
+/**
+ * @brief Fills the Zobrist keys with a fixed splitmix64 sequence, so hashes
+ * are reproducible across runs.
+ */
+static struct ZobristInitializer
+{
+    ZobristInitializer()
+    {
+        uint64_t seed = 0x45444176657273ULL;
+
+        for (int player = PLAYER_BLACK; player <= PLAYER_WHITE; player++)
+            for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+                zobristKeys[player][square] = getNextKey(seed);
+
+        for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+            zobristFlipKeys[square] = zobristKeys[PLAYER_BLACK][square] ^
+                                      zobristKeys[PLAYER_WHITE][square];
+
+        zobristPlayerKey = getNextKey(seed);
+    }
+
+    static uint64_t getNextKey(uint64_t &seed)
+    {
+        uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+} zobristInitializer;
+
+/**
+ * @brief In debug builds, checks the incrementally updated hash against a
+ * full recomputation.
  */
-static bool eatPieces(GameModel &model, Square source, Direction dir);
+#define CHECK_POSITION_HASH(position) \
+    assert((position).hash == getPositionHash(position))
 
 /**
- * @brief Recursive function to check if a square is a valid playing position. Similar implementation to eatPieces().
+ * @brief Recursive function to check if a square is a valid playing position.
  *
  * @param board The game board.
  * @param getCurrentPlayer The current player.
@@ -67,7 +128,7 @@ void startModel(GameModel &model)
 
     model.playerTime[0] = 0;
     model.playerTime[1] = 0;
-    model.turnTimer = GetTime();
+    model.turnTimer = getClock();
 
     memset(model.board, PIECE_EMPTY, sizeof(model.board));
     model.board[BOARD_SIZE / 2 - 1][BOARD_SIZE / 2 - 1] = PIECE_WHITE;
@@ -103,7 +164,7 @@ double getTimer(const GameModel &model, Player player)
     double turnTime = 0;
 
     if (!model.gameOver && (player == model.currentPlayer))
-        turnTime = GetTime() - model.turnTimer;
+        turnTime = getClock() - model.turnTimer;
 
     return model.playerTime[player] + turnTime;
 }
@@ -126,7 +187,7 @@ bool isSquareValid(Square square)
            (square.y < BOARD_SIZE);
 }
 
-void getValidMoves(const GameModel &model, Moves &validMoves)
+void getValidMoves(const GameModel &model, MoveList &validMoves)
 {
     for (int y = 0; y < BOARD_SIZE; y++)
         for (int x = 0; x < BOARD_SIZE; x++)
@@ -170,78 +231,387 @@ int getValidMovesNumber(const Board board, Player currentPlayer)
 
 bool playMove(GameModel &model, Square move)
 {
-    // Set game piece
-    Piece piece =
-        (getCurrentPlayer(model) == PLAYER_WHITE)
-            ? PIECE_WHITE
-            : PIECE_BLACK;
+    Position position;
+    getPosition(model, position);
 
-    setBoardPiece(model, move, piece);
-
-    for (Direction dir : {UP_RIGHT, UP, UP_LEFT, LEFT, LEFT_DOWN, DOWN, RIGHT_DOWN, RIGTH})
-        eatPieces(model, move, dir);
+    MoveUndo undo;
+    applyMove(position, getSquareIndex(move), undo);
 
     // Update timer
-    double currentTime = GetTime();
+    double currentTime = getClock();
     model.playerTime[model.currentPlayer] += currentTime - model.turnTimer;
     model.turnTimer = currentTime;
 
-    // Swap player
-    model.currentPlayer =
-        (model.currentPlayer == PLAYER_WHITE)
-            ? PLAYER_BLACK
-            : PLAYER_WHITE;
+    getPositionBoard(position, model.board);
+    model.currentPlayer = position.currentPlayer;
+    model.gameOver = position.gameOver;
 
-    // Game over?
-    Moves validMoves;
-    getValidMoves(model, validMoves);
+    return true;
+}
+
+void getPosition(const GameModel &model, Position &position)
+{
+    position.discs[PLAYER_BLACK] = 0;
+    position.discs[PLAYER_WHITE] = 0;
+
+    for (int y = 0; y < BOARD_SIZE; y++)
+        for (int x = 0; x < BOARD_SIZE; x++)
+        {
+            Bitboard bit = 1ULL << getSquareIndex({x, y});
 
-    if (validMoves.size() == 0)
+            if (model.board[y][x] == PIECE_BLACK)
+                position.discs[PLAYER_BLACK] |= bit;
+            else if (model.board[y][x] == PIECE_WHITE)
+                position.discs[PLAYER_WHITE] |= bit;
+        }
+
+    position.currentPlayer = model.currentPlayer;
+    position.gameOver = model.gameOver;
+    position.hash = getPositionHash(position);
+}
+
+void getPositionBoard(const Position &position, Board board)
+{
+    for (int y = 0; y < BOARD_SIZE; y++)
+        for (int x = 0; x < BOARD_SIZE; x++)
+        {
+            Bitboard bit = 1ULL << getSquareIndex({x, y});
+
+            if (position.discs[PLAYER_BLACK] & bit)
+                board[y][x] = PIECE_BLACK;
+            else if (position.discs[PLAYER_WHITE] & bit)
+                board[y][x] = PIECE_WHITE;
+            else
+                board[y][x] = PIECE_EMPTY;
+        }
+}
+
+void getPositionModel(const Position &position, GameModel &model)
+{
+    initModel(model);
+    getPositionBoard(position, model.board);
+    model.currentPlayer = position.currentPlayer;
+    model.gameOver = position.gameOver;
+    model.turnTimer = getClock();
+}
+
+bool parsePosition(const char *text, Position &position)
+{
+    position.discs[PLAYER_BLACK] = 0;
+    position.discs[PLAYER_WHITE] = 0;
+
+    int square = 0;
+    for (; *text && (square < BOARD_SIZE * BOARD_SIZE); text++)
     {
-        // Swap player
-        model.currentPlayer =
-            (model.currentPlayer == PLAYER_WHITE)
-                ? PLAYER_BLACK
-                : PLAYER_WHITE;
+        char c = *text;
 
-        Moves validMoves;
-        getValidMoves(model, validMoves);
+        if ((c == 'X') || (c == 'x') || (c == '*') || (c == 'B') || (c == 'b'))
+            position.discs[PLAYER_BLACK] |= 1ULL << square;
+        else if ((c == 'O') || (c == 'o') || (c == 'W') || (c == 'w'))
+            position.discs[PLAYER_WHITE] |= 1ULL << square;
+        else if ((c != '-') && (c != '.'))
+            continue;
 
-        if (validMoves.size() == 0)
-            model.gameOver = true;
+        square++;
     }
 
+    while ((*text == ' ') || (*text == '\t'))
+        text++;
+
+    char c = *text;
+    if ((c == 'X') || (c == 'x') || (c == '*') || (c == 'B') || (c == 'b'))
+        position.currentPlayer = PLAYER_BLACK;
+    else if ((c == 'O') || (c == 'o') || (c == 'W') || (c == 'w'))
+        position.currentPlayer = PLAYER_WHITE;
+    else
+        return false;
+
+    if (square < BOARD_SIZE * BOARD_SIZE)
+        return false;
+
+    Bitboard player = position.discs[position.currentPlayer];
+    Bitboard opponent = position.discs[position.currentPlayer ^ 1];
+    position.gameOver = !getMovesBitboard(player, opponent) && !getMovesBitboard(opponent, player);
+    position.hash = getPositionHash(position);
+
     return true;
 }
 
+/**
+ * @brief Adds the moves of one direction: runs of opponent discs adjacent to
+ * a player disc are grown (at most six long) and the empty square right
+ * after each run is a legal move.
+ */
+#define ADD_DIRECTION_MOVES(SHIFT)                 \
+    {                                              \
+        Bitboard run = SHIFT(player) & opponent;   \
+        run |= SHIFT(run) & opponent;              \
+        run |= SHIFT(run) & opponent;              \
+        run |= SHIFT(run) & opponent;              \
+        run |= SHIFT(run) & opponent;              \
+        run |= SHIFT(run) & opponent;              \
+        moves |= SHIFT(run) & empty;               \
+    }
+
+Bitboard getMovesBitboard(Bitboard player, Bitboard opponent)
+{
+    Bitboard empty = ~(player | opponent);
+    Bitboard moves = 0;
+
+    ADD_DIRECTION_MOVES(SHIFT_UP_RIGHT);
+    ADD_DIRECTION_MOVES(SHIFT_UP);
+    ADD_DIRECTION_MOVES(SHIFT_UP_LEFT);
+    ADD_DIRECTION_MOVES(SHIFT_LEFT);
+    ADD_DIRECTION_MOVES(SHIFT_LEFT_DOWN);
+    ADD_DIRECTION_MOVES(SHIFT_DOWN);
+    ADD_DIRECTION_MOVES(SHIFT_RIGHT_DOWN);
+    ADD_DIRECTION_MOVES(SHIFT_RIGHT);
+
+    return moves;
+}
+
+/**
+ * @brief Adds the flips of one direction: walks the opponent discs next to
+ * the move and keeps them only if the run is closed by a player disc.
+ */
+#define ADD_DIRECTION_FLIPS(SHIFT)                 \
+    {                                              \
+        Bitboard run = 0;                          \
+        Bitboard cursor = SHIFT(move);             \
+        while (cursor & opponent)                  \
+        {                                          \
+            run |= cursor;                         \
+            cursor = SHIFT(cursor);                \
+        }                                          \
+        if (cursor & player)                       \
+            flips |= run;                          \
+    }
+
+Bitboard getFlipsBitboard(Bitboard player, Bitboard opponent, int square)
+{
+    Bitboard move = 1ULL << square;
+    Bitboard flips = 0;
+
+    if ((player | opponent) & move)
+        return 0;
+
+    ADD_DIRECTION_FLIPS(SHIFT_UP_RIGHT);
+    ADD_DIRECTION_FLIPS(SHIFT_UP);
+    ADD_DIRECTION_FLIPS(SHIFT_UP_LEFT);
+    ADD_DIRECTION_FLIPS(SHIFT_LEFT);
+    ADD_DIRECTION_FLIPS(SHIFT_LEFT_DOWN);
+    ADD_DIRECTION_FLIPS(SHIFT_DOWN);
+    ADD_DIRECTION_FLIPS(SHIFT_RIGHT_DOWN);
+    ADD_DIRECTION_FLIPS(SHIFT_RIGHT);
+
+    return flips;
+}
+
+Bitboard getAdjacentBitboard(Bitboard bitboard)
+{
+    return SHIFT_UP_RIGHT(bitboard) |
+           SHIFT_UP(bitboard) |
+           SHIFT_UP_LEFT(bitboard) |
+           SHIFT_LEFT(bitboard) |
+           SHIFT_LEFT_DOWN(bitboard) |
+           SHIFT_DOWN(bitboard) |
+           SHIFT_RIGHT_DOWN(bitboard) |
+           SHIFT_RIGHT(bitboard);
+}
+
+/**
+ * @brief Mirrors the files of a bitboard: reverses the bits of each rank.
+ */
+static inline Bitboard mirrorFiles(Bitboard bitboard)
+{
+    bitboard = ((bitboard >> 1) & 0x5555555555555555ULL) | ((bitboard & 0x5555555555555555ULL) << 1);
+    bitboard = ((bitboard >> 2) & 0x3333333333333333ULL) | ((bitboard & 0x3333333333333333ULL) << 2);
+    return ((bitboard >> 4) & 0x0f0f0f0f0f0f0f0fULL) | ((bitboard & 0x0f0f0f0f0f0f0f0fULL) << 4);
+}
+
+/**
+ * @brief Mirrors the ranks of a bitboard: reverses its bytes.
+ */
+static inline Bitboard mirrorRanks(Bitboard bitboard)
+{
+    bitboard = ((bitboard >> 8) & 0x00ff00ff00ff00ffULL) | ((bitboard & 0x00ff00ff00ff00ffULL) << 8);
+    bitboard = ((bitboard >> 16) & 0x0000ffff0000ffffULL) | ((bitboard & 0x0000ffff0000ffffULL) << 16);
+    return (bitboard >> 32) | (bitboard << 32);
+}
+
+/**
+ * @brief Swaps the files and ranks of a bitboard: transposes it along the
+ * a1-h8 diagonal.
+ */
+static inline Bitboard swapFilesRanks(Bitboard bitboard)
+{
+    Bitboard t;
+    t = 0x0f0f0f0f00000000ULL & (bitboard ^ (bitboard << 28));
+    bitboard ^= t ^ (t >> 28);
+    t = 0x3333000033330000ULL & (bitboard ^ (bitboard << 14));
+    bitboard ^= t ^ (t >> 14);
+    t = 0x5500550055005500ULL & (bitboard ^ (bitboard << 7));
+    return bitboard ^ t ^ (t >> 7);
+}
+
+Bitboard getSymmetricBitboard(Bitboard bitboard, int symmetry)
+{
+    if (symmetry & 1)
+        bitboard = mirrorFiles(bitboard);
+    if (symmetry & 2)
+        bitboard = mirrorRanks(bitboard);
+    if (symmetry & 4)
+        bitboard = swapFilesRanks(bitboard);
+
+    return bitboard;
+}
+
+void getSymmetricBitboards(Bitboard bitboard, Bitboard symmetric[SYMMETRY_COUNT])
+{
+    symmetric[0] = bitboard;
+    symmetric[1] = mirrorFiles(bitboard);
+    symmetric[2] = mirrorRanks(bitboard);
+    symmetric[3] = mirrorRanks(symmetric[1]);
 
-static bool eatPieces(GameModel &model, Square source, Direction dir)
+    for (int symmetry = 0; symmetry < 4; symmetry++)
+        symmetric[symmetry | 4] = swapFilesRanks(symmetric[symmetry]);
+}
+
+uint64_t getDiscsHash(Bitboard player, Bitboard opponent)
 {
-    if(!isSquareValid({source.x+2*dir.x, source.y+2*dir.y})) return false;
-    if(!isSquareValid({source.x+dir.x, source.y+dir.y})) return false;
+    uint64_t hash = player * 0x9e3779b97f4a7c15ULL;
+    hash ^= (opponent ^ (hash >> 31)) * 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 29;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 32;
 
-    Player currentPlayer = getCurrentPlayer(model);
-    Piece eatablePiece = currentPlayer==PLAYER_BLACK ? PIECE_WHITE : PIECE_BLACK;
-    Piece eatingPiece = eatablePiece==PIECE_BLACK ? PIECE_WHITE : PIECE_BLACK;
+    return hash;
+}
 
-    if(model.board[source.y+dir.y][source.x+dir.x] == eatablePiece)
+int getSymmetricSquare(int square, int symmetry)
+{
+    int x = square % BOARD_SIZE;
+    int y = square / BOARD_SIZE;
+
+    if (symmetry & 1)
+        x = BOARD_SIZE - 1 - x;
+    if (symmetry & 2)
+        y = BOARD_SIZE - 1 - y;
+    if (symmetry & 4)
     {
-        if(model.board[source.y+2*dir.y][source.x+2*dir.x] == eatingPiece) // Base case
-        {
-            model.board[source.y+dir.y][source.x+dir.x] = eatingPiece;
-            return true;
-        }else if(model.board[source.y+2*dir.y][source.x+2*dir.x] == eatablePiece) // Recursive case
-        {
-            if(eatPieces(model, {source.x+dir.x, source.y+dir.y}, dir))
-            {
-                model.board[source.y+dir.y][source.x+dir.x] = eatingPiece;
-                return true;
-            }
-        }
-        
+        int t = x;
+        x = y;
+        y = t;
     }
-    
-    return false; // Reached when model.board[source.y+dir.y][source.x+dir.x] != eatablePiece || model.board[source.y+2*dir.y][source.x+2*dir.x] == PIECE_EMPTY
+
+    return y * BOARD_SIZE + x;
+}
+
+uint64_t getPositionHash(const Position &position)
+{
+    uint64_t hash = 0;
+
+    for (int player = PLAYER_BLACK; player <= PLAYER_WHITE; player++)
+        for (Bitboard discs = position.discs[player]; discs; discs &= discs - 1)
+            hash ^= zobristKeys[player][getFirstBit(discs)];
+
+    if (position.currentPlayer == PLAYER_WHITE)
+        hash ^= zobristPlayerKey;
+
+    return hash;
+}
+
+/**
+ * @brief Returns the hash change of placing a disc and flipping others.
+ *
+ * @param player The player who moves.
+ * @param square The square index of the move.
+ * @param flips The flipped discs.
+ * @return The value to XOR into the position hash.
+ */
+static uint64_t getMoveHashDelta(Player player, int square, Bitboard flips)
+{
+    uint64_t delta = zobristKeys[player][square];
+
+    for (; flips; flips &= flips - 1)
+        delta ^= zobristFlipKeys[getFirstBit(flips)];
+
+    return delta;
+}
+
+void makeMove(Position &position, int square, MoveUndo &undo)
+{
+    Player player = position.currentPlayer;
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    Bitboard flips = getFlipsBitboard(position.discs[player],
+                                      position.discs[opponent],
+                                      square);
+
+    undo.square = square;
+    undo.flips = flips;
+    undo.player = player;
+
+    position.discs[player] |= flips | (1ULL << square);
+    position.discs[opponent] ^= flips;
+    position.currentPlayer = opponent;
+    position.hash ^= getMoveHashDelta(player, square, flips) ^ zobristPlayerKey;
+
+    CHECK_POSITION_HASH(position);
+}
+
+void makePass(Position &position, MoveUndo &undo)
+{
+    undo.square = -1;
+    undo.flips = 0;
+    undo.player = position.currentPlayer;
+
+    position.currentPlayer =
+        (position.currentPlayer == PLAYER_WHITE)
+            ? PLAYER_BLACK
+            : PLAYER_WHITE;
+    position.hash ^= zobristPlayerKey;
+
+    CHECK_POSITION_HASH(position);
+}
+
+void unmakeMove(Position &position, const MoveUndo &undo)
+{
+    Player player = undo.player;
+    Player opponent = (player == PLAYER_WHITE) ? PLAYER_BLACK : PLAYER_WHITE;
+
+    if (undo.square >= 0)
+    {
+        position.discs[player] ^= undo.flips | (1ULL << undo.square);
+        position.discs[opponent] |= undo.flips;
+        position.hash ^= getMoveHashDelta(player, undo.square, undo.flips);
+    }
+
+    if (position.currentPlayer != player)
+        position.hash ^= zobristPlayerKey;
+
+    position.currentPlayer = player;
+    position.gameOver = false;
+
+    CHECK_POSITION_HASH(position);
+}
+
+void applyMove(Position &position, int square, MoveUndo &undo)
+{
+    makeMove(position, square, undo);
+
+    // Pass?
+    if (!getPositionMoves(position))
+    {
+        position.currentPlayer = undo.player;
+        position.hash ^= zobristPlayerKey;
+
+        // Game over?
+        if (!getPositionMoves(position))
+            position.gameOver = true;
+    }
+
+    CHECK_POSITION_HASH(position);
 }
 
 static bool checkCurrentSquare(const Board board, Player currentPlayer, Square source, Direction dir)
@@ -8,8 +8,13 @@
 #ifndef MODEL_H
 #define MODEL_H
 
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
-#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 #define BOARD_SIZE 8
 
@@ -39,7 +44,67 @@ struct Square
 
 typedef Piece Board[BOARD_SIZE][BOARD_SIZE];
 
-typedef std::vector<Square> Moves;
+// Legal moves can't outnumber the empty squares
+#define MOVE_LIST_CAPACITY (BOARD_SIZE * BOARD_SIZE - 4)
+
+/**
+ * @brief A fixed-capacity list of moves, kept on the stack: filling one
+ * never allocates.
+ */
+struct MoveList
+{
+    Square moves[MOVE_LIST_CAPACITY];
+    int count;
+
+    MoveList() : count(0) {}
+
+    void push_back(Square move)
+    {
+        assert(count < MOVE_LIST_CAPACITY);
+        moves[count++] = move;
+    }
+
+    void clear() { count = 0; }
+    size_t size() const { return count; }
+    bool empty() const { return !count; }
+
+    Square &operator[](size_t index) { return moves[index]; }
+    const Square &operator[](size_t index) const { return moves[index]; }
+
+    Square *begin() { return moves; }
+    Square *end() { return moves + count; }
+    const Square *begin() const { return moves; }
+    const Square *end() const { return moves + count; }
+};
+
+/**
+ * @brief One bit per square, bit (y * BOARD_SIZE + x) for square {x, y}.
+ */
+typedef uint64_t Bitboard;
+
+/**
+ * @brief Compact bitboard position used by the search and evaluation.
+ */
+struct Position
+{
+    Bitboard discs[2]; // Indexed by Player
+
+    Player currentPlayer;
+
+    bool gameOver;
+
+    uint64_t hash; // Zobrist hash, kept up to date by the move functions
+};
+
+/**
+ * @brief Information needed to undo a move played with makeMove().
+ */
+struct MoveUndo
+{
+    int square; // -1 for a pass
+    Bitboard flips;
+    Player player;
+};
 
 struct GameModel
 {
@@ -127,7 +192,7 @@ bool isSquareValid(Square square);
  * @param model The game model.
  * @param validMoves A list that receives the valid moves.
  */
-void getValidMoves(const GameModel &model, Moves &validMoves);
+void getValidMoves(const GameModel &model, MoveList &validMoves);
 
 /**
  * @brief Returns the number of moves a player can make
@@ -138,7 +203,7 @@ void getValidMoves(const GameModel &model, Moves &validMoves);
 int getValidMovesNumber(const Board board, Player player);
 
 /**
- * @brief Plays a move.
+ * @brief Plays a move and updates the players' clocks.
  *
  * @param model The game model.
  * @param square The move.
@@ -146,4 +211,234 @@ int getValidMovesNumber(const Board board, Player player);
  */
 bool playMove(GameModel &model, Square move);
 
+/**
+ * @brief Returns the number of set bits of a bitboard.
+ *
+ * @param bitboard The bitboard.
+ * @return The number of set bits.
+ */
+inline int countBits(Bitboard bitboard)
+{
+#if defined(_MSC_VER)
+    return (int)__popcnt64(bitboard);
+#else
+    return __builtin_popcountll(bitboard);
+#endif
+}
+
+/**
+ * @brief Returns the index of the lowest set bit of a non-empty bitboard.
+ *
+ * @param bitboard The bitboard.
+ * @return The square index.
+ */
+inline int getFirstBit(Bitboard bitboard)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bitboard);
+    return (int)index;
+#else
+    return __builtin_ctzll(bitboard);
+#endif
+}
+
+/**
+ * @brief Returns the square index of a square.
+ *
+ * @param square The square.
+ * @return The square index (0-63).
+ */
+inline int getSquareIndex(Square square)
+{
+    return square.y * BOARD_SIZE + square.x;
+}
+
+/**
+ * @brief Returns the square of a square index.
+ *
+ * @param index The square index (0-63).
+ * @return The square.
+ */
+inline Square getIndexSquare(int index)
+{
+    return {index % BOARD_SIZE, index / BOARD_SIZE};
+}
+
+/**
+ * @brief Converts a game model into a bitboard position.
+ *
+ * @param model The game model.
+ * @param position The position that receives the model's board and player.
+ */
+void getPosition(const GameModel &model, Position &position);
+
+/**
+ * @brief Converts a bitboard position into a board.
+ *
+ * @param position The position.
+ * @param board The board that receives the position's discs.
+ */
+void getPositionBoard(const Position &position, Board board);
+
+/**
+ * @brief Converts a bitboard position into a game model, with both clocks
+ * at zero.
+ *
+ * @param position The position.
+ * @param model The game model.
+ */
+void getPositionModel(const Position &position, GameModel &model);
+
+/**
+ * @brief Reads a position written on one line: the 64 squares from a1 to h8
+ * rank by rank ('X' or '*' black, 'O' white, '-' or '.' empty; other
+ * characters are skipped), then the player to move ('X' or 'O').
+ *
+ * @param text The text, which may go on after the player to move.
+ * @param position Receives the position.
+ * @return true if the text holds a position.
+ */
+bool parsePosition(const char *text, Position &position);
+
+/**
+ * @brief Returns the legal moves of a player as a bitboard.
+ *
+ * @param player The discs of the player to move.
+ * @param opponent The discs of the opponent.
+ * @return A bitboard with one bit per legal move.
+ */
+Bitboard getMovesBitboard(Bitboard player, Bitboard opponent);
+
+/**
+ * @brief Returns the discs flipped by a move.
+ *
+ * @param player The discs of the player to move.
+ * @param opponent The discs of the opponent.
+ * @param square The square index of the move.
+ * @return A bitboard with the flipped discs (empty if the move is illegal).
+ */
+Bitboard getFlipsBitboard(Bitboard player, Bitboard opponent, int square);
+
+/**
+ * @brief Returns the squares adjacent (in any of the eight directions) to a
+ * set of squares.
+ *
+ * @param bitboard The set of squares.
+ * @return The adjacent squares.
+ */
+Bitboard getAdjacentBitboard(Bitboard bitboard);
+
+/**
+ * @brief Returns the legal moves of the position's current player.
+ *
+ * @param position The position.
+ * @return A bitboard with one bit per legal move.
+ */
+inline Bitboard getPositionMoves(const Position &position)
+{
+    return getMovesBitboard(position.discs[position.currentPlayer],
+                            position.discs[position.currentPlayer ^ 1]);
+}
+
+#define SYMMETRY_COUNT 8
+
+/**
+ * @brief Applies one of the 8 board symmetries to a bitboard. Bit 0 of the
+ * symmetry mirrors the files, bit 1 mirrors the ranks, and bit 2 then swaps
+ * files and ranks; 0 is the identity.
+ *
+ * @param bitboard The bitboard.
+ * @param symmetry The symmetry (0-7).
+ * @return The transformed bitboard.
+ */
+Bitboard getSymmetricBitboard(Bitboard bitboard, int symmetry);
+
+/**
+ * @brief Applies all 8 board symmetries to a bitboard, sharing the work.
+ *
+ * @param bitboard The bitboard.
+ * @param symmetric Receives the bitboard under each symmetry.
+ */
+void getSymmetricBitboards(Bitboard bitboard, Bitboard symmetric[SYMMETRY_COUNT]);
+
+/**
+ * @brief Applies one of the 8 board symmetries to a square index.
+ *
+ * @param square The square index.
+ * @param symmetry The symmetry (0-7).
+ * @return The transformed square index.
+ */
+int getSymmetricSquare(int square, int symmetry);
+
+/**
+ * @brief Returns the symmetry that undoes another one.
+ *
+ * @param symmetry The symmetry (0-7).
+ * @return The inverse symmetry.
+ */
+inline int getInverseSymmetry(int symmetry)
+{
+    // Swapping files and ranks exchanges which mirror applies to which axis
+    if (symmetry & 4)
+        return 4 | ((symmetry & 1) << 1) | ((symmetry >> 1) & 1);
+
+    return symmetry;
+}
+
+/**
+ * @brief Hashes a pair of bitboards directly, for keys that can't be
+ * updated incrementally like the Zobrist hash.
+ *
+ * @param player The discs of the player to move.
+ * @param opponent The discs of the opponent.
+ * @return The hash.
+ */
+uint64_t getDiscsHash(Bitboard player, Bitboard opponent);
+
+/**
+ * @brief Computes the Zobrist hash of a position from scratch.
+ *
+ * @param position The position.
+ * @return The hash.
+ */
+uint64_t getPositionHash(const Position &position);
+
+/**
+ * @brief Plays a move in place, without pass or game over handling.
+ *
+ * @param position The position.
+ * @param square The square index of a legal move.
+ * @param undo Receives what is needed to undo the move.
+ */
+void makeMove(Position &position, int square, MoveUndo &undo);
+
+/**
+ * @brief Passes the turn in place.
+ *
+ * @param position The position.
+ * @param undo Receives what is needed to undo the pass.
+ */
+void makePass(Position &position, MoveUndo &undo);
+
+/**
+ * @brief Restores the position before a makeMove(), makePass() or
+ * applyMove() call.
+ *
+ * @param position The position.
+ * @param undo The record filled by the matching call.
+ */
+void unmakeMove(Position &position, const MoveUndo &undo);
+
+/**
+ * @brief Plays a move following the game rules: the turn passes back to the
+ * mover if the opponent cannot move, and the game ends if neither can.
+ * Does no clock bookkeeping and no heap allocation.
+ *
+ * @param position The position.
+ * @param square The square index of a legal move.
+ * @param undo Receives what is needed to undo the move with unmakeMove().
+ */
+void applyMove(Position &position, int square, MoveUndo &undo);
+
 #endif
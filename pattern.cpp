@@ -0,0 +1,225 @@
+/**
+ * @brief Implements the pattern evaluation of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "pattern.h"
+
+#define SQUARE_MAX_FEATURES 16
+
+static const int PATTERN_TYPE_SIZES[PATTERN_TYPES] = {10, 9, 10, 8, 7, 6, 5, 4};
+
+/**
+ * @brief The squares of each pattern type, taken at the a1 corner; the other
+ * features are its symmetric copies. Coordinates are {x, y}.
+ */
+static const int PATTERN_TYPE_SQUARES[PATTERN_TYPES][PATTERN_MAX_SQUARES][2] = {
+    // Edge + 2X
+    {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}, {5, 0}, {6, 0}, {7, 0}, {1, 1}, {6, 1}},
+    // Corner 3x3
+    {{0, 0}, {1, 0}, {2, 0}, {0, 1}, {1, 1}, {2, 1}, {0, 2}, {1, 2}, {2, 2}},
+    // Corner 2x5
+    {{0, 0}, {1, 0}, {2, 0}, {3, 0}, {4, 0}, {0, 1}, {1, 1}, {2, 1}, {3, 1}, {4, 1}},
+    // Diagonals
+    {{0, 0}, {1, 1}, {2, 2}, {3, 3}, {4, 4}, {5, 5}, {6, 6}, {7, 7}},
+    {{1, 0}, {2, 1}, {3, 2}, {4, 3}, {5, 4}, {6, 5}, {7, 6}},
+    {{2, 0}, {3, 1}, {4, 2}, {5, 3}, {6, 4}, {7, 5}},
+    {{3, 0}, {4, 1}, {5, 2}, {6, 3}, {7, 4}},
+    {{4, 0}, {5, 1}, {6, 2}, {7, 3}},
+};
+
+/**
+ * @brief Feature layout, built at startup.
+ */
+static int featureSquares[PATTERN_FEATURES][PATTERN_MAX_SQUARES];
+static int featureSizes[PATTERN_FEATURES];
+static int featureOffsets[PATTERN_FEATURES];
+
+/**
+ * @brief Features each square belongs to, with the square's base-3 weight
+ * in each.
+ */
+static int squareFeatures[BOARD_SIZE * BOARD_SIZE][SQUARE_MAX_FEATURES];
+static int squarePowers[BOARD_SIZE * BOARD_SIZE][SQUARE_MAX_FEATURES];
+static int squareFeatureCounts[BOARD_SIZE * BOARD_SIZE];
+
+static struct PatternInitializer
+{
+    PatternInitializer()
+    {
+        int feature = 0;
+        int typeOffset = 0;
+
+        for (int type = 0; type < PATTERN_TYPES; type++)
+        {
+            int size = PATTERN_TYPE_SIZES[type];
+            Bitboard instances[8];
+            int instanceCount = 0;
+
+            // Each of the 8 board symmetries, skipping those that map the
+            // pattern onto a copy already added
+            for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++)
+            {
+                int squares[PATTERN_MAX_SQUARES];
+                Bitboard mask = 0;
+
+                for (int i = 0; i < size; i++)
+                {
+                    int x = PATTERN_TYPE_SQUARES[type][i][0];
+                    int y = PATTERN_TYPE_SQUARES[type][i][1];
+
+                    squares[i] = getSymmetricSquare(y * BOARD_SIZE + x, symmetry);
+                    mask |= 1ULL << squares[i];
+                }
+
+                bool duplicate = false;
+                for (int i = 0; i < instanceCount; i++)
+                    duplicate |= (instances[i] == mask);
+                if (duplicate)
+                    continue;
+                instances[instanceCount++] = mask;
+
+                int power = 1;
+                for (int i = 0; i < size; i++)
+                {
+                    int square = squares[i];
+                    int &count = squareFeatureCounts[square];
+
+                    featureSquares[feature][i] = square;
+                    squareFeatures[square][count] = feature;
+                    squarePowers[square][count] = power;
+                    count++;
+                    power *= 3;
+                }
+
+                featureSizes[feature] = size;
+                featureOffsets[feature] = typeOffset;
+                feature++;
+            }
+
+            int typeWeights = 1;
+            for (int i = 0; i < size; i++)
+                typeWeights *= 3;
+            typeOffset += typeWeights;
+        }
+    }
+} patternInitializer;
+
+bool loadPatternWeights(PatternWeights &weights, const char *path)
+{
+    weights.weights = NULL;
+
+    if (!openMappedFile(weights.file, path))
+        return false;
+
+    const PatternFileHeader *header = (const PatternFileHeader *)weights.file.data;
+    size_t expectedSize = sizeof(PatternFileHeader) +
+                          sizeof(int16_t) * PATTERN_PHASES * PATTERN_WEIGHT_COUNT;
+
+    if ((weights.file.size != expectedSize) ||
+        memcmp(header->magic, PATTERN_FILE_MAGIC, sizeof(header->magic)) ||
+        (header->version != PATTERN_FILE_VERSION) ||
+        (header->phaseCount != PATTERN_PHASES) ||
+        (header->weightCount != PATTERN_WEIGHT_COUNT))
+    {
+        std::cerr << "Invalid pattern weight file: " << path << std::endl;
+        closeMappedFile(weights.file);
+        return false;
+    }
+
+    weights.weights = (const int16_t *)(header + 1);
+
+    return true;
+}
+
+void freePatternWeights(PatternWeights &weights)
+{
+    closeMappedFile(weights.file);
+    weights.weights = NULL;
+}
+
+bool savePatternWeights(const char *path, const int16_t *weights)
+{
+    FILE *file = fopen(path, "wb");
+    if (!file)
+        return false;
+
+    PatternFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PATTERN_FILE_MAGIC, sizeof(header.magic));
+    header.version = PATTERN_FILE_VERSION;
+    header.phaseCount = PATTERN_PHASES;
+    header.weightCount = PATTERN_WEIGHT_COUNT;
+
+    size_t count = (size_t)PATTERN_PHASES * PATTERN_WEIGHT_COUNT;
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                   (fwrite(weights, sizeof(int16_t), count, file) == count);
+
+    return (fclose(file) == 0) && written;
+}
+
+void getPatternIndices(const Position &position, PatternIndices &indices)
+{
+    for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+    {
+        int index = 0;
+
+        for (int i = featureSizes[feature] - 1; i >= 0; i--)
+        {
+            Bitboard square = 1ULL << featureSquares[feature][i];
+
+            index *= 3;
+            if (position.discs[PLAYER_BLACK] & square)
+                index += 1;
+            else if (position.discs[PLAYER_WHITE] & square)
+                index += 2;
+        }
+
+        indices.indices[feature] = (uint16_t)index;
+    }
+}
+
+void updatePatternIndices(PatternIndices &indices, Player player, int square, Bitboard flips)
+{
+    // The placed disc goes from empty (0) to the player's digit (1 or 2)
+    int placedDigit = (player == PLAYER_BLACK) ? 1 : 2;
+    for (int i = 0; i < squareFeatureCounts[square]; i++)
+        indices.indices[squareFeatures[square][i]] += placedDigit * squarePowers[square][i];
+
+    // Flipped discs go from the opponent's digit to the player's
+    int flipDigit = (player == PLAYER_BLACK) ? -1 : 1;
+    for (; flips; flips &= flips - 1)
+    {
+        int flipped = getFirstBit(flips);
+
+        for (int i = 0; i < squareFeatureCounts[flipped]; i++)
+            indices.indices[squareFeatures[flipped][i]] += flipDigit * squarePowers[flipped][i];
+    }
+}
+
+int getPatternWeightOffset(int feature)
+{
+    return featureOffsets[feature];
+}
+
+int evaluatePatterns(const PatternWeights &weights, const PatternIndices &indices, int discCount, Player maxPlayer)
+{
+    const int16_t *phaseWeights = weights.weights + getPatternPhase(discCount) * PATTERN_WEIGHT_COUNT;
+    int score = 0;
+
+    for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+        score += phaseWeights[featureOffsets[feature] + indices.indices[feature]];
+
+    if (score > PATTERN_SCORE_MAX)
+        score = PATTERN_SCORE_MAX;
+    else if (score < -PATTERN_SCORE_MAX)
+        score = -PATTERN_SCORE_MAX;
+
+    return (maxPlayer == PLAYER_BLACK) ? score : -score;
+}
@@ -0,0 +1,146 @@
+/**
+ * @brief Implements the pattern evaluation of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+#include <cstdint>
+
+#include "mappedfile.h"
+#include "model.h"
+
+#define PATTERN_FILE_MAGIC "EDAPTRN"
+#define PATTERN_FILE_VERSION 1
+
+// Features: 4 edges + 2X, 4 corner 3x3, 8 corner 2x5, 2 + 4 + 4 + 4 + 4
+// diagonals of 8 down to 4 squares
+#define PATTERN_FEATURES 34
+#define PATTERN_TYPES 8
+#define PATTERN_MAX_SQUARES 10
+
+// Weights per phase: 3^10 + 3^9 + 3^10 + 3^8 + 3^7 + 3^6 + 3^5 + 3^4
+#define PATTERN_WEIGHT_COUNT 147582
+
+// Game phases, by number of discs on the board
+#define PATTERN_PHASES 6
+
+// Pattern scores stay below the search's scores for finished games
+#define PATTERN_SCORE_MAX 800
+
+// Evaluation units per disc of final disc difference
+#define PATTERN_DISC_SCALE 8
+
+/**
+ * @brief Header of a pattern weight file. It is followed by
+ * PATTERN_PHASES * PATTERN_WEIGHT_COUNT little-endian int16_t weights.
+ */
+struct PatternFileHeader
+{
+	char magic[8];          // PATTERN_FILE_MAGIC
+	uint32_t version;       // PATTERN_FILE_VERSION
+	uint32_t phaseCount;    // PATTERN_PHASES
+	uint32_t weightCount;   // PATTERN_WEIGHT_COUNT
+	uint32_t reserved;
+};
+
+/**
+ * @brief Pattern weights, mapped read-only from a weight file so processes
+ * share one copy. Weights are relative to black.
+ */
+struct PatternWeights
+{
+	const int16_t *weights; // [PATTERN_PHASES][PATTERN_WEIGHT_COUNT], NULL if not loaded
+
+	MappedFile file;
+};
+
+/**
+ * @brief Base-3 index of every feature: each square counts 0 when empty,
+ * 1 when black and 2 when white.
+ */
+struct PatternIndices
+{
+	uint16_t indices[PATTERN_FEATURES];
+};
+
+/**
+ * @brief Loads pattern weights from a weight file.
+ *
+ * @param weights The weights, left unloaded on failure.
+ * @param path The file path.
+ * @return true if the file was loaded, false if it is missing or invalid.
+ */
+bool loadPatternWeights(PatternWeights &weights, const char *path);
+
+/**
+ * @brief Releases loaded pattern weights.
+ *
+ * @param weights The weights.
+ */
+void freePatternWeights(PatternWeights &weights);
+
+/**
+ * @brief Writes a pattern weight file.
+ *
+ * @param path The file path.
+ * @param weights The weights, [PATTERN_PHASES][PATTERN_WEIGHT_COUNT],
+ * relative to black.
+ * @return true on success.
+ */
+bool savePatternWeights(const char *path, const int16_t *weights);
+
+/**
+ * @brief Computes every feature index of a position from scratch.
+ *
+ * @param position The position.
+ * @param indices Receives the indices.
+ */
+void getPatternIndices(const Position &position, PatternIndices &indices);
+
+/**
+ * @brief Updates the feature indices after a move.
+ *
+ * @param indices The indices.
+ * @param player The player who moved.
+ * @param square The square index of the move.
+ * @param flips The flipped discs.
+ */
+void updatePatternIndices(PatternIndices &indices, Player player, int square, Bitboard flips);
+
+/**
+ * @brief Returns the game phase of a position.
+ *
+ * @param discCount The number of discs on the board.
+ * @return The phase, from 0 to PATTERN_PHASES - 1.
+ */
+inline int getPatternPhase(int discCount)
+{
+    int phase = (discCount - 4) / 10;
+
+    return (phase < PATTERN_PHASES) ? phase : PATTERN_PHASES - 1;
+}
+
+/**
+ * @brief Returns where a feature's weights start within a phase.
+ *
+ * @param feature The feature.
+ * @return The offset into the phase's weights.
+ */
+int getPatternWeightOffset(int feature);
+
+/**
+ * @brief Evaluates a position by summing its feature weights.
+ *
+ * @param weights The loaded weights.
+ * @param indices The position's feature indices.
+ * @param discCount The number of discs on the board.
+ * @param maxPlayer The player the score is relative to.
+ * @return The score (positive is good for maxPlayer).
+ */
+int evaluatePatterns(const PatternWeights &weights, const PatternIndices &indices, int discCount, Player maxPlayer);
+
+#endif
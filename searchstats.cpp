@@ -0,0 +1,93 @@
+/**
+ * @brief Implements the search statistics of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "searchstats.h"
+
+void clearSearchStats(SearchStats &stats)
+{
+    memset(&stats, 0, sizeof(stats));
+}
+
+void addSearchStats(SearchStats &total, const SearchStats &stats)
+{
+    total.nodes += stats.nodes;
+    total.leaves += stats.leaves;
+    total.tableProbes += stats.tableProbes;
+    total.tableHits += stats.tableHits;
+    total.tableCutoffs += stats.tableCutoffs;
+    total.cutoffs += stats.cutoffs;
+
+    for (int i = 0; i < SEARCH_STATS_CUTOFF_SLOTS; i++)
+        total.cutoffIndices[i] += stats.cutoffIndices[i];
+}
+
+void recordSearchIteration(SearchStats &stats, int depth, uint64_t nodes, double time)
+{
+    if (stats.iterationCount >= SEARCH_STATS_MAX_ITERATIONS)
+        return;
+
+    int i = stats.iterationCount++;
+    stats.iterationDepths[i] = depth;
+    stats.iterationNodes[i] = nodes;
+    stats.iterationTimes[i] = time;
+}
+
+double getEffectiveBranchingFactor(const SearchStats &stats)
+{
+    int last = stats.iterationCount - 1;
+    if (last < 1)
+        return 0;
+
+    int first = (last >= 2) ? last - 2 : last - 1;
+    int plies = stats.iterationDepths[last] - stats.iterationDepths[first];
+    if ((plies <= 0) || !stats.iterationNodes[first])
+        return 0;
+
+    return pow((double)stats.iterationNodes[last] / stats.iterationNodes[first], 1.0 / plies);
+}
+
+void appendSearchStatsJson(std::string &json, const SearchStats &stats, double time)
+{
+    char buffer[256];
+
+    snprintf(buffer, sizeof(buffer),
+             ",\"nodes\":%llu,\"interior\":%llu,\"leaves\":%llu,\"nps\":%.0f"
+             ",\"tt_probes\":%llu,\"tt_hits\":%llu,\"tt_cutoffs\":%llu"
+             ",\"cutoffs\":%llu,\"ebf\":%.2f",
+             (unsigned long long)stats.nodes,
+             (unsigned long long)(stats.nodes - stats.leaves),
+             (unsigned long long)stats.leaves,
+             (time > 0) ? stats.nodes / time : 0,
+             (unsigned long long)stats.tableProbes,
+             (unsigned long long)stats.tableHits,
+             (unsigned long long)stats.tableCutoffs,
+             (unsigned long long)stats.cutoffs,
+             getEffectiveBranchingFactor(stats));
+    json += buffer;
+
+    json += ",\"cutoff_index\":[";
+    for (int i = 0; i < SEARCH_STATS_CUTOFF_SLOTS; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "%s%llu", i ? "," : "",
+                 (unsigned long long)stats.cutoffIndices[i]);
+        json += buffer;
+    }
+
+    json += "],\"iterations\":[";
+    for (int i = 0; i < stats.iterationCount; i++)
+    {
+        snprintf(buffer, sizeof(buffer), "%s{\"depth\":%d,\"nodes\":%llu,\"time\":%.6f}",
+                 i ? "," : "", stats.iterationDepths[i],
+                 (unsigned long long)stats.iterationNodes[i], stats.iterationTimes[i]);
+        json += buffer;
+    }
+    json += "]";
+}
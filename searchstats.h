@@ -0,0 +1,100 @@
+/**
+ * @brief Implements the search statistics of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef SEARCHSTATS_H
+#define SEARCHSTATS_H
+
+#include <cstdint>
+#include <string>
+
+// Beta cutoffs by the index of the move that caused them; the last slot
+// counts every later move
+#define SEARCH_STATS_CUTOFF_SLOTS 8
+
+#define SEARCH_STATS_MAX_ITERATIONS 64
+
+/**
+ * @brief Counters of one search. Every search thread keeps its own, so they
+ * are never shared while the search runs; the totals are summed with
+ * addSearchStats() once the threads have joined.
+ */
+struct SearchStats
+{
+	uint64_t nodes;        // Every position visited, leaves included
+	uint64_t leaves;       // Positions evaluated or scored as finished
+	uint64_t tableProbes;
+	uint64_t tableHits;    // Probes that found the position
+	uint64_t tableCutoffs; // Hits whose stored bound ended the node's search
+	uint64_t cutoffs;      // Beta cutoffs
+	uint64_t cutoffIndices[SEARCH_STATS_CUTOFF_SLOTS];
+
+	// Completed iterations of the thread's iterative deepening
+	int iterationCount;
+	int iterationDepths[SEARCH_STATS_MAX_ITERATIONS];
+	uint64_t iterationNodes[SEARCH_STATS_MAX_ITERATIONS];
+	double iterationTimes[SEARCH_STATS_MAX_ITERATIONS]; // Seconds
+};
+
+/**
+ * @brief Resets search statistics.
+ *
+ * @param stats The statistics.
+ */
+void clearSearchStats(SearchStats &stats);
+
+/**
+ * @brief Adds a thread's counters to a total. The total keeps its own
+ * iterations: those of the main thread.
+ *
+ * @param total The total.
+ * @param stats The thread's statistics.
+ */
+void addSearchStats(SearchStats &total, const SearchStats &stats);
+
+/**
+ * @brief Records a beta cutoff.
+ *
+ * @param stats The statistics.
+ * @param moveIndex The position of the cutoff move in the search order.
+ */
+inline void recordSearchCutoff(SearchStats &stats, int moveIndex)
+{
+    stats.cutoffs++;
+    stats.cutoffIndices[(moveIndex < SEARCH_STATS_CUTOFF_SLOTS) ? moveIndex : SEARCH_STATS_CUTOFF_SLOTS - 1]++;
+}
+
+/**
+ * @brief Records a completed iteration.
+ *
+ * @param stats The statistics.
+ * @param depth The iteration's depth.
+ * @param nodes The nodes it visited.
+ * @param time The seconds it took.
+ */
+void recordSearchIteration(SearchStats &stats, int depth, uint64_t nodes, double time);
+
+/**
+ * @brief Returns the effective branching factor: the growth in nodes per
+ * extra ply of depth, over the last three iterations (two plies smooth
+ * out the odd/even depth effect).
+ *
+ * @param stats The statistics.
+ * @return The factor, 0 with fewer than two iterations.
+ */
+double getEffectiveBranchingFactor(const SearchStats &stats);
+
+/**
+ * @brief Appends the statistics as JSON object members, each preceded by a
+ * comma.
+ *
+ * @param json The JSON text.
+ * @param stats The statistics.
+ * @param time The seconds the whole search took, for the speed.
+ */
+void appendSearchStatsJson(std::string &json, const SearchStats &stats, double time);
+
+#endif
@@ -0,0 +1,254 @@
+/**
+ * @brief Implements stable disc detection for the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include "stability.h"
+
+#define EDGE_CONFIGURATIONS 256
+
+#define FILE_A 0x0101010101010101ULL
+#define FILE_A_TO_RANK 0x0102040810204080ULL
+#define INNER_SQUARES 0x007e7e7e7e7e7e00ULL
+
+/**
+ * @brief Stable discs of the first player of an edge, indexed by both
+ * players' discs on it (bit i is the i-th square along the edge).
+ */
+static uint8_t edgeStability[EDGE_CONFIGURATIONS * EDGE_CONFIGURATIONS];
+
+/**
+ * @brief Maps a packed edge back to the squares of file A.
+ */
+static Bitboard fileAEdges[EDGE_CONFIGURATIONS];
+
+/**
+ * @brief Squares whose diagonal neighbour 1, 2 and 4 steps away falls off
+ * the board, per diagonal (up-left, up-right) and sense (up, down).
+ */
+static Bitboard diagonalBorders[2][2][3];
+
+static const int DIAGONAL_STEPS[2] = {7, 9};
+
+/**
+ * @brief Packs file A into an edge byte.
+ */
+static inline int getFileAEdge(Bitboard bitboard)
+{
+    return (int)(((bitboard & FILE_A) * FILE_A_TO_RANK) >> 56);
+}
+
+/**
+ * @brief Plays a move on a single edge, flipping along it.
+ *
+ * @param player The mover's discs on the edge, updated.
+ * @param opponent The other player's discs on the edge, updated.
+ * @param x The empty square along the edge.
+ */
+static void playEdgeMove(int &player, int &opponent, int x)
+{
+    player |= 1 << x;
+
+    for (int dx = -1; dx <= 1; dx += 2)
+    {
+        int flips = 0;
+        int y = x + dx;
+
+        while ((y >= 0) && (y < BOARD_SIZE) && (opponent & (1 << y)))
+        {
+            flips |= 1 << y;
+            y += dx;
+        }
+
+        if ((y >= 0) && (y < BOARD_SIZE) && (player & (1 << y)))
+        {
+            player ^= flips;
+            opponent ^= flips;
+        }
+    }
+}
+
+/**
+ * @brief Builds the edge table, from full edges down to empty ones: a disc
+ * is stable if it stays the player's after any move of either player.
+ */
+static struct StabilityInitializer
+{
+    StabilityInitializer()
+    {
+        for (int discCount = BOARD_SIZE; discCount >= 0; discCount--)
+        {
+            for (int player = 0; player < EDGE_CONFIGURATIONS; player++)
+            {
+                for (int opponent = 0; opponent < EDGE_CONFIGURATIONS; opponent++)
+                {
+                    if ((player & opponent) || (countBits(player | opponent) != discCount))
+                        continue;
+
+                    edgeStability[player * EDGE_CONFIGURATIONS + opponent] =
+                        (uint8_t)getEdgeStability(player, opponent);
+                }
+            }
+        }
+
+        for (int square = 0; square < BOARD_SIZE; square++)
+        {
+            Bitboard fileSquare = 1ULL << (square * BOARD_SIZE);
+            for (int edge = 0; edge < EDGE_CONFIGURATIONS; edge++)
+                if (edge & getFileAEdge(fileSquare))
+                    fileAEdges[edge] |= fileSquare;
+        }
+
+        for (int diagonal = 0; diagonal < 2; diagonal++)
+        {
+            int dx = (diagonal == 0) ? -1 : 1;
+
+            for (int i = 0; i < 3; i++)
+            {
+                int steps = 1 << i;
+
+                for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+                {
+                    int x = square % BOARD_SIZE;
+                    int y = square / BOARD_SIZE;
+
+                    for (int sense = 0; sense < 2; sense++)
+                    {
+                        int sign = (sense == 0) ? 1 : -1;
+                        int nx = x + sign * dx * steps;
+                        int ny = y + sign * steps;
+
+                        if ((nx < 0) || (nx >= BOARD_SIZE) || (ny < 0) || (ny >= BOARD_SIZE))
+                            diagonalBorders[diagonal][sense][i] |= 1ULL << square;
+                    }
+                }
+            }
+        }
+    }
+
+    static int getEdgeStability(int player, int opponent)
+    {
+        int empty = ~(player | opponent) & (EDGE_CONFIGURATIONS - 1);
+        int stable = player;
+
+        for (int x = 0; (x < BOARD_SIZE) && stable; x++)
+        {
+            if (!(empty & (1 << x)))
+                continue;
+
+            int nextPlayer = player;
+            int nextOpponent = opponent;
+            playEdgeMove(nextPlayer, nextOpponent, x);
+            stable &= edgeStability[nextPlayer * EDGE_CONFIGURATIONS + nextOpponent];
+
+            nextPlayer = player;
+            nextOpponent = opponent;
+            playEdgeMove(nextOpponent, nextPlayer, x);
+            stable &= edgeStability[nextPlayer * EDGE_CONFIGURATIONS + nextOpponent];
+        }
+
+        return stable;
+    }
+} stabilityInitializer;
+
+/**
+ * @brief Looks up the stable discs on the four edges.
+ */
+static Bitboard getStableEdges(Bitboard player, Bitboard opponent)
+{
+    Bitboard stable;
+
+    stable = edgeStability[(player & 0xff) * EDGE_CONFIGURATIONS + (opponent & 0xff)];
+    stable |= (Bitboard)edgeStability[(player >> 56) * EDGE_CONFIGURATIONS + (opponent >> 56)] << 56;
+    stable |= fileAEdges[edgeStability[getFileAEdge(player) * EDGE_CONFIGURATIONS +
+                                       getFileAEdge(opponent)]];
+    stable |= fileAEdges[edgeStability[getFileAEdge(player >> 7) * EDGE_CONFIGURATIONS +
+                                       getFileAEdge(opponent >> 7)]] << 7;
+
+    return stable;
+}
+
+/**
+ * @brief Returns the squares whose rank is fully occupied.
+ */
+static Bitboard getFullRanks(Bitboard occupied)
+{
+    occupied &= occupied >> 1;
+    occupied &= occupied >> 2;
+    occupied &= occupied >> 4;
+
+    return (occupied & FILE_A) * 0xff;
+}
+
+/**
+ * @brief Returns the squares whose file is fully occupied.
+ */
+static Bitboard getFullFiles(Bitboard occupied)
+{
+    occupied &= (occupied >> 8) | (occupied << 56);
+    occupied &= (occupied >> 16) | (occupied << 48);
+    occupied &= (occupied >> 32) | (occupied << 32);
+
+    return occupied;
+}
+
+/**
+ * @brief Returns the squares whose diagonal is fully occupied, by checking
+ * 1, 2 and then 4 squares further along each sense.
+ */
+static Bitboard getFullDiagonals(Bitboard occupied, int diagonal)
+{
+    Bitboard up = occupied;
+    Bitboard down = occupied;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int shift = DIAGONAL_STEPS[diagonal] << i;
+
+        up &= (up >> shift) | diagonalBorders[diagonal][0][i];
+        down &= (down << shift) | diagonalBorders[diagonal][1][i];
+    }
+
+    return up & down;
+}
+
+Bitboard getStableBitboard(Bitboard player, Bitboard opponent)
+{
+    Bitboard occupied = player | opponent;
+    Bitboard inner = player & INNER_SQUARES;
+
+    // Full lines can't be played on, so they protect their discs
+    Bitboard fullRanks = getFullRanks(occupied);
+    Bitboard fullFiles = getFullFiles(occupied);
+
+    Bitboard stable = getStableEdges(player, opponent);
+
+    // Without a stable disc or a fully protected inner disc there is
+    // nothing to propagate from, which is the usual case in the midgame
+    if (!stable && !(inner & fullRanks & fullFiles))
+        return 0;
+
+    Bitboard fullUpLeft = getFullDiagonals(occupied, 0);
+    Bitboard fullUpRight = getFullDiagonals(occupied, 1);
+
+    stable |= inner & fullRanks & fullFiles & fullUpLeft & fullUpRight;
+
+    // A disc next to a stable disc of its colour can't be flipped along
+    // that line; stable in all four lines makes it stable
+    Bitboard previous = 0;
+    while (stable != previous)
+    {
+        previous = stable;
+
+        Bitboard rank = (stable >> 1) | (stable << 1) | fullRanks;
+        Bitboard file = (stable >> 8) | (stable << 8) | fullFiles;
+        Bitboard upLeft = (stable >> 7) | (stable << 7) | fullUpLeft;
+        Bitboard upRight = (stable >> 9) | (stable << 9) | fullUpRight;
+
+        stable |= inner & rank & file & upLeft & upRight;
+    }
+
+    return stable;
+}
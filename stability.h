@@ -0,0 +1,39 @@
+/**
+ * @brief Implements stable disc detection for the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef STABILITY_H
+#define STABILITY_H
+
+#include "model.h"
+
+/**
+ * @brief Finds discs that can never be flipped, whatever is played.
+ *
+ * Combines edge discs proven stable by a precomputed table of every edge
+ * configuration, inner discs whose four lines are full, and discs anchored
+ * in every direction by a stable neighbour. The result is a subset of the
+ * truly stable discs.
+ *
+ * @param player The discs whose stability is computed.
+ * @param opponent The other player's discs.
+ * @return The stable discs of player.
+ */
+Bitboard getStableBitboard(Bitboard player, Bitboard opponent);
+
+/**
+ * @brief Counts the stable discs of a player.
+ *
+ * @param player The discs whose stability is computed.
+ * @param opponent The other player's discs.
+ * @return The number of stable discs.
+ */
+inline int getStableCount(Bitboard player, Bitboard opponent)
+{
+    return countBits(getStableBitboard(player, opponent));
+}
+
+#endif
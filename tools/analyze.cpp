@@ -0,0 +1,342 @@
+/**
+ * @brief Batch position analysis with the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Streams positions, one per line in the OBF/FFO board text (64 squares of
+ * X, O and -, then the player to move; anything after it is ignored),
+ * searches each on a pool of workers, and writes one result line per
+ * position, in input order, as soon as it is known. Only a small window of
+ * lines is held in memory, so inputs of any length work.
+ */
+
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+
+#define DEFAULT_MOVE_TIME 1.0
+#define DEFAULT_TABLE_SIZE_MB 16
+
+// Lines read ahead of the oldest unwritten result, per worker
+#define WINDOW_PER_WORKER 4
+
+struct AnalyzeOptions
+{
+    const char *inputPath;
+    const char *outputPath;
+    int depth;
+    double moveTime;
+    int workers;
+};
+
+struct AnalysisJob
+{
+    uint64_t index;
+    std::string line;
+};
+
+/**
+ * @brief Lines waiting for a worker, and results waiting for the results of
+ * earlier lines before they can be written.
+ */
+struct AnalysisQueue
+{
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable windowFree;
+
+    std::deque<AnalysisJob> jobs;
+    bool inputDone;
+
+    std::map<uint64_t, std::string> results;
+    uint64_t nextWrite;
+
+    FILE *output;
+    uint64_t nodes;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-analyze [options]\n"
+                 "  --input FILE     Positions, one per line (default: standard input)\n"
+                 "  --output FILE    Results (default: standard output)\n"
+                 "  --depth N        Depth limit (no time limit unless --time is given)\n"
+                 "  --time SECONDS   Time per position (default "
+              << DEFAULT_MOVE_TIME << ")\n"
+                 "  --workers N      Positions searched at once (default: one per core)\n"
+                 "  --hash MB        Transposition table size per worker (default "
+              << DEFAULT_TABLE_SIZE_MB << ")\n"
+                 "  --weights FILE   Pattern weight file\n"
+                 "  --endgame N      Solve exactly from N empty squares\n";
+}
+
+static bool parseOptions(int argc, char *argv[], AnalyzeOptions &options, AIConfig &config)
+{
+    options.inputPath = NULL;
+    options.outputPath = NULL;
+    options.depth = 0;
+    options.moveTime = 0;
+    options.workers = std::thread::hardware_concurrency();
+
+    getDefaultAIConfig(config);
+    config.tableSizeMB = DEFAULT_TABLE_SIZE_MB;
+    config.threads = 1;
+    config.weightsPath = NULL;
+    config.bookPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--input") && hasValue)
+            options.inputPath = argv[++i];
+        else if (!strcmp(argv[i], "--output") && hasValue)
+            options.outputPath = argv[++i];
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--time") && hasValue)
+            options.moveTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--workers") && hasValue)
+            options.workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hash") && hasValue)
+            config.tableSizeMB = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--weights") && hasValue)
+            config.weightsPath = argv[++i];
+        else if (!strcmp(argv[i], "--endgame") && hasValue)
+            config.endgameEmpties = atoi(argv[++i]);
+        else
+            return false;
+    }
+
+    if ((options.depth < 0) || (options.depth > SEARCH_MAX_DEPTH) || (options.moveTime < 0))
+        return false;
+
+    if (options.workers < 1)
+        options.workers = 1;
+
+    // A depth alone searches without a clock
+    if (!options.depth && !options.moveTime)
+        options.moveTime = DEFAULT_MOVE_TIME;
+
+    config.maxDepth = options.depth ? options.depth : SEARCH_MAX_DEPTH;
+    config.moveTime = options.moveTime;
+    config.gameTime = 0;
+
+    return true;
+}
+
+/**
+ * @brief Returns the position part of an input line: up to the player to
+ * move, without the annotations that may follow.
+ */
+static std::string getPositionText(const std::string &line)
+{
+    size_t end = line.find(';');
+    if (end == std::string::npos)
+        end = line.size();
+
+    while ((end > 0) && isspace((unsigned char)line[end - 1]))
+        end--;
+
+    return line.substr(0, end);
+}
+
+/**
+ * @brief Searches one input line and formats its result line.
+ */
+static std::string analyzeLine(AIEngine &engine, const std::string &line, uint64_t &nodes)
+{
+    std::string text = getPositionText(line);
+
+    Position position;
+    if (!parsePosition(text.c_str(), position))
+        return text + " error invalid position";
+    if (position.gameOver)
+        return text + " error game over";
+
+    GameModel model;
+    getPositionModel(position, model);
+
+    // A player without moves passes; the model never waits on one
+    bool passed = !getPositionMoves(position);
+    if (passed)
+        model.currentPlayer = (model.currentPlayer == PLAYER_BLACK) ? PLAYER_WHITE : PLAYER_BLACK;
+
+    SearchLimits limits;
+    getSearchLimits(engine, model, limits);
+
+    SearchResult result;
+    Square move = findBestMove(engine, model, limits, result);
+    nodes = result.stats.nodes;
+
+    // Scores are relative to the player to move in the input
+    int score = passed ? -result.score : result.score;
+
+    char buffer[128];
+    if (passed)
+        snprintf(buffer, sizeof(buffer), " move pass");
+    else
+        snprintf(buffer, sizeof(buffer), " move %c%c", 'a' + move.x, '1' + move.y);
+    text += buffer;
+
+    snprintf(buffer, sizeof(buffer), " score %d depth %d%s nodes %llu time %.3f",
+             score, result.depth, result.solved ? " solved" : "",
+             (unsigned long long)result.stats.nodes, result.time);
+    text += buffer;
+
+    return text;
+}
+
+/**
+ * @brief A worker: takes lines until the input is exhausted, and writes
+ * every result that no earlier line is still waiting for.
+ */
+static void runWorker(AnalysisQueue *queue, const AIConfig *config)
+{
+    AIEngine engine;
+    initAIEngine(engine, *config);
+
+    while (true)
+    {
+        AnalysisJob job;
+        {
+            std::unique_lock<std::mutex> lock(queue->mutex);
+            queue->jobReady.wait(lock, [queue]()
+                                 { return !queue->jobs.empty() || queue->inputDone; });
+            if (queue->jobs.empty())
+                break;
+
+            job = queue->jobs.front();
+            queue->jobs.pop_front();
+        }
+
+        uint64_t nodes = 0;
+        std::string result = analyzeLine(engine, job.line, nodes);
+
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->nodes += nodes;
+        queue->results[job.index] = result;
+
+        bool written = false;
+        for (auto it = queue->results.begin();
+             (it != queue->results.end()) && (it->first == queue->nextWrite);
+             it = queue->results.erase(it))
+        {
+            fprintf(queue->output, "%s\n", it->second.c_str());
+            queue->nextWrite++;
+            written = true;
+        }
+
+        if (written)
+        {
+            fflush(queue->output);
+            queue->windowFree.notify_one();
+        }
+    }
+
+    freeAIEngine(engine);
+}
+
+int main(int argc, char *argv[])
+{
+    AnalyzeOptions options;
+    AIConfig config;
+    if (!parseOptions(argc, argv, options, config))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::ifstream inputFile;
+    if (options.inputPath)
+    {
+        inputFile.open(options.inputPath);
+        if (!inputFile)
+        {
+            std::cerr << "Could not open " << options.inputPath << std::endl;
+            return 1;
+        }
+    }
+    std::istream &input = options.inputPath ? inputFile : std::cin;
+
+    AnalysisQueue queue;
+    queue.inputDone = false;
+    queue.nextWrite = 0;
+    queue.nodes = 0;
+    queue.output = stdout;
+    if (options.outputPath)
+    {
+        queue.output = fopen(options.outputPath, "w");
+        if (!queue.output)
+        {
+            std::cerr << "Could not open " << options.outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    double startTime = std::chrono::duration<double>(
+                           std::chrono::steady_clock::now().time_since_epoch())
+                           .count();
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.workers; i++)
+        workers.push_back(std::thread(runWorker, &queue, &config));
+
+    // Read ahead only while the window of unwritten lines has room
+    uint64_t window = (uint64_t)WINDOW_PER_WORKER * options.workers;
+    uint64_t lineCount = 0;
+    std::string line;
+
+    while (std::getline(input, line))
+    {
+        if (getPositionText(line).empty() || (line[0] == '#'))
+            continue;
+
+        std::unique_lock<std::mutex> lock(queue.mutex);
+        queue.windowFree.wait(lock, [&]()
+                              { return lineCount - queue.nextWrite < window; });
+
+        AnalysisJob job;
+        job.index = lineCount++;
+        job.line = line;
+        queue.jobs.push_back(job);
+        queue.jobReady.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.inputDone = true;
+    }
+    queue.jobReady.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    if (options.outputPath)
+        fclose(queue.output);
+
+    double time = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now().time_since_epoch())
+                      .count() -
+                  startTime;
+
+    fprintf(stderr, "positions %llu nodes %llu time %.3f nps %.0f\n",
+            (unsigned long long)lineCount, (unsigned long long)queue.nodes, time,
+            (time > 0) ? queue.nodes / time : 0);
+
+    return 0;
+}
@@ -0,0 +1,618 @@
+/**
+ * @brief Micro-benchmarks of the Reversi game model and AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Times the engine's hot paths over a fixed suite of positions, taken from
+ * seeded random games, and writes one JSON line per benchmark so the results
+ * of two versions can be diffed. Built optimised and without sanitizers.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+
+#include "ai.h"
+
+#define SUITE_SEED 20240101
+#define SUITE_GAMES 8
+#define SUITE_PLY_STEP 8    // Positions at plies 8, 16, ..., 48 of each game
+#define SUITE_MAX_PLY 48
+#define SUITE_MIDGAME_PLY 40 // Later positions are solved by the endgame search
+
+#define DEFAULT_MIN_TIME 0.5
+#define DEFAULT_SEARCH_DEPTH 8
+#define DEFAULT_TABLE_SIZE_MB 64
+
+#define HASHING_GAMES 2     // Games replayed in all 8 orientations
+#define HASHING_PLIES 24
+
+#define SMP_MAX_THREADS 16
+
+/**
+ * @brief Heap allocations made by the whole process, counted by the
+ * replaced global operator new.
+ */
+static std::atomic<uint64_t> allocationCount(0);
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer)
+        throw std::bad_alloc();
+
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+struct BenchOptions
+{
+    const char *outputPath;
+    const char *filter;
+    const char *weightsPath;
+    double minTime;
+    int depth;
+    bool check;
+};
+
+#define SUITE_SIZE (SUITE_GAMES * SUITE_MAX_PLY / SUITE_PLY_STEP)
+
+/**
+ * @brief The positions benchmarked, ordered by ply: midgame ones first.
+ */
+struct BenchSuite
+{
+    GameModel models[SUITE_SIZE];
+    Position positions[SUITE_SIZE];
+    int count;
+    int midgameCount;
+
+    int games[SUITE_GAMES][BOARD_SIZE * BOARD_SIZE]; // Moves of each game
+    int gameLengths[SUITE_GAMES];
+};
+
+/**
+ * @brief One benchmark's measurements.
+ */
+struct BenchResult
+{
+    uint64_t ops;
+    double time;
+    uint64_t nodes;       // Search nodes, 0 for the non-search benchmarks
+    uint64_t allocations;
+};
+
+static FILE *outputFile;
+
+// Keeps the optimiser from dropping the benchmarked calls
+static volatile uint64_t sink;
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-bench [options]\n"
+                 "  --output FILE    Also write the JSON lines to FILE\n"
+                 "  --filter TEXT    Only run the benchmarks whose name contains TEXT\n"
+                 "  --time SECONDS   Minimum time per micro-benchmark (default "
+              << DEFAULT_MIN_TIME << ")\n"
+                 "  --depth N        Search depth (default "
+              << DEFAULT_SEARCH_DEPTH << ")\n"
+                 "  --weights FILE   Pattern weight file (default: built-in evaluation)\n"
+                 "  --check          Instead of timing, check that the model moves and full\n"
+                 "                   single-threaded searches make no heap allocations\n";
+}
+
+static bool parseOptions(int argc, char *argv[], BenchOptions &options)
+{
+    options.outputPath = NULL;
+    options.filter = NULL;
+    options.weightsPath = NULL;
+    options.minTime = DEFAULT_MIN_TIME;
+    options.depth = DEFAULT_SEARCH_DEPTH;
+    options.check = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--output") && hasValue)
+            options.outputPath = argv[++i];
+        else if (!strcmp(argv[i], "--filter") && hasValue)
+            options.filter = argv[++i];
+        else if (!strcmp(argv[i], "--weights") && hasValue)
+            options.weightsPath = argv[++i];
+        else if (!strcmp(argv[i], "--time") && hasValue)
+            options.minTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--check"))
+            options.check = true;
+        else
+            return false;
+    }
+
+    return (options.minTime > 0) && (options.depth > 0) && (options.depth <= SEARCH_MAX_DEPTH);
+}
+
+static double getClock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Builds the position suite from seeded random games. std::mt19937
+ * is fully specified, so every platform gets the same suite.
+ */
+static void initBenchSuite(BenchSuite &suite)
+{
+    std::mt19937 random(SUITE_SEED);
+    Position samples[SUITE_MAX_PLY / SUITE_PLY_STEP][SUITE_GAMES];
+    bool sampled[SUITE_MAX_PLY / SUITE_PLY_STEP][SUITE_GAMES] = {};
+
+    for (int game = 0; game < SUITE_GAMES; game++)
+    {
+        GameModel model;
+        initModel(model);
+        startModel(model);
+
+        Position position;
+        getPosition(model, position);
+
+        int ply = 0;
+        while (!position.gameOver)
+        {
+            Bitboard moves = getPositionMoves(position);
+            int skip = random() % countBits(moves);
+            for (int i = 0; i < skip; i++)
+                moves &= moves - 1;
+
+            int square = getFirstBit(moves);
+            suite.games[game][ply++] = square;
+
+            MoveUndo undo;
+            applyMove(position, square, undo);
+
+            if (((ply % SUITE_PLY_STEP) == 0) && (ply <= SUITE_MAX_PLY) && !position.gameOver)
+            {
+                samples[ply / SUITE_PLY_STEP - 1][game] = position;
+                sampled[ply / SUITE_PLY_STEP - 1][game] = true;
+            }
+        }
+
+        suite.gameLengths[game] = ply;
+    }
+
+    suite.count = 0;
+    for (int step = 0; step < SUITE_MAX_PLY / SUITE_PLY_STEP; step++)
+    {
+        if ((step + 1) * SUITE_PLY_STEP > SUITE_MIDGAME_PLY)
+            suite.midgameCount = suite.count;
+
+        for (int game = 0; game < SUITE_GAMES; game++)
+        {
+            if (!sampled[step][game])
+                continue;
+
+            suite.positions[suite.count] = samples[step][game];
+            getPositionModel(samples[step][game], suite.models[suite.count]);
+            suite.count++;
+        }
+    }
+}
+
+static bool isSelected(const BenchOptions &options, const char *name)
+{
+    return !options.filter || strstr(name, options.filter);
+}
+
+/**
+ * @brief Writes one benchmark as a JSON line, to stdout and the output file.
+ */
+static void printResult(const char *name, const BenchResult &result, const std::string &extra = "")
+{
+    char line[512];
+    double ops = result.ops ? (double)result.ops : 1;
+
+    snprintf(line, sizeof(line),
+             "{\"name\":\"%s\",\"ops\":%llu,\"time\":%.6f,\"ns_per_op\":%.2f,"
+             "\"nodes\":%llu,\"nodes_per_sec\":%.0f,\"allocs_per_op\":%.3f%s}\n",
+             name, (unsigned long long)result.ops, result.time, 1e9 * result.time / ops,
+             (unsigned long long)result.nodes, (result.time > 0) ? result.nodes / result.time : 0,
+             result.allocations / ops, extra.c_str());
+
+    fputs(line, stdout);
+    fflush(stdout);
+    if (outputFile)
+        fputs(line, outputFile);
+}
+
+/**
+ * @brief Runs a micro-benchmark over the whole suite, repeating it until
+ * the minimum time is reached.
+ *
+ * @param function Called once per suite position, returns a value to sink.
+ */
+template <typename Function>
+static void runMicroBenchmark(const BenchOptions &options, const char *name, const BenchSuite &suite, Function function)
+{
+    if (!isSelected(options, name))
+        return;
+
+    // Warm up, so one-time setup is not measured
+    uint64_t checksum = function(0);
+
+    BenchResult result = {0, 0, 0, 0};
+    uint64_t allocationStart = allocationCount;
+    double startTime = getClock();
+
+    for (uint64_t rounds = 1; result.time < options.minTime; rounds *= 2)
+    {
+        for (uint64_t round = 0; round < rounds; round++)
+            for (int i = 0; i < suite.count; i++)
+                checksum += function(i);
+
+        result.ops += rounds * suite.count;
+        result.time = getClock() - startTime;
+    }
+
+    result.allocations = allocationCount - allocationStart;
+    sink = checksum;
+
+    printResult(name, result);
+}
+
+/**
+ * @brief Sets up an engine for fixed-depth searches without book or clock.
+ */
+static void initBenchEngine(AIEngine &engine, const BenchOptions &options, int threads, bool canonicalHashing)
+{
+    AIConfig config;
+    getDefaultAIConfig(config);
+
+    config.tableSizeMB = DEFAULT_TABLE_SIZE_MB;
+    config.threads = threads;
+    config.canonicalHashing = canonicalHashing;
+    config.maxDepth = options.depth;
+    config.moveTime = 0;
+    config.gameTime = 0;
+    config.weightsPath = options.weightsPath;
+    config.bookPath = NULL;
+
+    initAIEngine(engine, config);
+}
+
+/**
+ * @brief Searches a range of the suite to the benchmark depth, clearing the
+ * table before each position.
+ */
+static void runSearchBenchmark(const BenchOptions &options, const BenchSuite &suite, int threads, int first, int last, BenchResult &result)
+{
+    AIEngine engine;
+    initBenchEngine(engine, options, threads, false);
+
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.softTime = 0;
+    limits.hardTime = 0;
+
+    result.ops = 0;
+    result.time = 0;
+    result.nodes = 0;
+    result.allocations = 0;
+
+    for (int i = first; i < last; i++)
+    {
+        clearTranspositionTable(engine.table);
+
+        SearchResult searchResult;
+        uint64_t allocationStart = allocationCount;
+        findBestMove(engine, suite.models[i], limits, searchResult);
+
+        result.allocations += allocationCount - allocationStart;
+        result.ops++;
+        result.time += searchResult.time;
+        result.nodes += searchResult.stats.nodes;
+    }
+
+    freeAIEngine(engine);
+}
+
+static std::string getSearchFields(const BenchOptions &options, int threads)
+{
+    char fields[64];
+    snprintf(fields, sizeof(fields), ",\"depth\":%d,\"threads\":%d", options.depth, threads);
+
+    return fields;
+}
+
+/**
+ * @brief Fixed-depth searches of the midgame and endgame positions, and the
+ * Lazy SMP time-to-depth speedup on the midgame ones.
+ */
+static void runSearchBenchmarks(const BenchOptions &options, const BenchSuite &suite)
+{
+    BenchResult result;
+
+    if (isSelected(options, "search-midgame"))
+    {
+        runSearchBenchmark(options, suite, 1, 0, suite.midgameCount, result);
+        printResult("search-midgame", result, getSearchFields(options, 1));
+    }
+
+    if (isSelected(options, "search-endgame"))
+    {
+        runSearchBenchmark(options, suite, 1, suite.midgameCount, suite.count, result);
+        printResult("search-endgame", result, getSearchFields(options, 1));
+    }
+
+    // Lazy SMP time-to-depth: the same searches with more threads
+    double baseTime = 0;
+    for (int threads = 1; threads <= SMP_MAX_THREADS; threads *= 2)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "smp-%d", threads);
+        if (!isSelected(options, name))
+            continue;
+
+        runSearchBenchmark(options, suite, threads, 0, suite.midgameCount, result);
+        if (threads == 1)
+            baseTime = result.time;
+
+        char speedup[32];
+        snprintf(speedup, sizeof(speedup), ",\"speedup\":%.2f",
+                 ((baseTime > 0) && (result.time > 0)) ? baseTime / result.time : 0);
+        printResult(name, result, getSearchFields(options, threads) + speedup);
+    }
+}
+
+/**
+ * @brief Replays suite games in all 8 orientations with one table kept
+ * throughout, as the game keeps it between moves, to compare plain and
+ * symmetry-canonical table keys.
+ */
+static void runHashingBenchmark(const BenchOptions &options, const char *name, const BenchSuite &suite, bool canonicalHashing)
+{
+    if (!isSelected(options, name))
+        return;
+
+    AIEngine engine;
+    initBenchEngine(engine, options, 1, canonicalHashing);
+
+    SearchLimits limits;
+    limits.depth = options.depth;
+    limits.softTime = 0;
+    limits.hardTime = 0;
+
+    BenchResult result = {0, 0, 0, 0};
+    uint64_t allocationStart = allocationCount;
+    uint64_t tableProbes = 0;
+    uint64_t tableHits = 0;
+
+    for (int game = 0; game < HASHING_GAMES; game++)
+    {
+        for (int symmetry = 0; symmetry < SYMMETRY_COUNT; symmetry++)
+        {
+            GameModel model;
+            initModel(model);
+            startModel(model);
+
+            // The start position in the replay's orientation, so the
+            // transformed moves are the legal ones
+            Position position;
+            getPosition(model, position);
+            position.discs[PLAYER_BLACK] = getSymmetricBitboard(position.discs[PLAYER_BLACK], symmetry);
+            position.discs[PLAYER_WHITE] = getSymmetricBitboard(position.discs[PLAYER_WHITE], symmetry);
+            position.hash = getPositionHash(position);
+
+            for (int ply = 0; (ply < HASHING_PLIES) && (ply < suite.gameLengths[game]); ply++)
+            {
+                getPositionModel(position, model);
+
+                SearchResult searchResult;
+                findBestMove(engine, model, limits, searchResult);
+
+                result.ops++;
+                result.time += searchResult.time;
+                result.nodes += searchResult.stats.nodes;
+                tableProbes += searchResult.stats.tableProbes;
+                tableHits += searchResult.stats.tableHits;
+
+                int square = getSymmetricSquare(suite.games[game][ply], symmetry);
+                if (!((getPositionMoves(position) >> square) & 1))
+                {
+                    fprintf(stderr, "%s: illegal move in game %d, symmetry %d, ply %d\n",
+                            name, game, symmetry, ply);
+                    exit(1);
+                }
+
+                MoveUndo undo;
+                applyMove(position, square, undo);
+            }
+        }
+    }
+
+    result.allocations = allocationCount - allocationStart;
+    freeAIEngine(engine);
+
+    char table[128];
+    snprintf(table, sizeof(table), ",\"tt_probes\":%llu,\"tt_hits\":%llu,\"tt_hit_rate\":%.4f",
+             (unsigned long long)tableProbes, (unsigned long long)tableHits,
+             tableProbes ? (double)tableHits / tableProbes : 0);
+    printResult(name, result, getSearchFields(options, 1) + table);
+}
+
+/**
+ * @brief Prints the outcome of one allocation check.
+ *
+ * @return Whether no allocation was made.
+ */
+static bool reportAllocations(const char *name, int positionCount, uint64_t allocations)
+{
+    printf("allocations %s positions %d count %llu %s\n", name, positionCount,
+           (unsigned long long)allocations, allocations ? "FAILED" : "ok");
+
+    return !allocations;
+}
+
+/**
+ * @brief Checks that the hot paths allocate nothing once set up: move
+ * generation and playing on the model, and complete single-threaded
+ * searches of every suite position (endgame solving included), with and
+ * without shallow ordering and canonical keys. Extra search threads are
+ * left out: starting a thread allocates.
+ *
+ * @return Whether no allocation was made.
+ */
+static bool checkAllocations(const BenchOptions &options, const BenchSuite &suite)
+{
+    uint64_t allocationStart = allocationCount;
+    for (int i = 0; i < suite.count; i++)
+    {
+        MoveList moves;
+        getValidMoves(suite.models[i], moves);
+
+        GameModel model = suite.models[i];
+        playMove(model, moves[0]);
+    }
+    bool passed = reportAllocations("model", suite.count, allocationCount - allocationStart);
+
+    for (int variant = 0; variant < 2; variant++)
+    {
+        AIEngine engine;
+        initBenchEngine(engine, options, 1, variant == 1);
+        engine.config.shallowOrdering = (variant == 1);
+
+        SearchLimits limits;
+        limits.depth = options.depth;
+        limits.softTime = 0;
+        limits.hardTime = 0;
+
+        uint64_t allocations = 0;
+        for (int i = 0; i < suite.count; i++)
+        {
+            clearTranspositionTable(engine.table);
+
+            SearchResult result;
+            allocationStart = allocationCount;
+            findBestMove(engine, suite.models[i], limits, result);
+            allocations += allocationCount - allocationStart;
+        }
+
+        passed &= reportAllocations(variant ? "search-shallow-canonical" : "search",
+                                    suite.count, allocations);
+
+        freeAIEngine(engine);
+    }
+
+    return passed;
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    outputFile = NULL;
+    if (options.outputPath)
+    {
+        outputFile = fopen(options.outputPath, "w");
+        if (!outputFile)
+        {
+            std::cerr << "Could not open " << options.outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    static BenchSuite suite;
+    initBenchSuite(suite);
+
+    if (options.check)
+        return checkAllocations(options, suite) ? 0 : 1;
+
+    PatternWeights weights = PatternWeights();
+    if (options.weightsPath && !loadPatternWeights(weights, options.weightsPath))
+        return 1;
+
+    runMicroBenchmark(options, "getValidMoves", suite, [&](int i) {
+        MoveList moves;
+        getValidMoves(suite.models[i], moves);
+        return (uint64_t)moves.size();
+    });
+
+    runMicroBenchmark(options, "getValidMovesNumber", suite, [&](int i) {
+        return (uint64_t)getValidMovesNumber(suite.models[i].board, suite.models[i].currentPlayer);
+    });
+
+    runMicroBenchmark(options, "getMovesBitboard", suite, [&](int i) {
+        return (uint64_t)getPositionMoves(suite.positions[i]);
+    });
+
+    runMicroBenchmark(options, "playMove", suite, [&](int i) {
+        GameModel model = suite.models[i];
+        Bitboard moves = getPositionMoves(suite.positions[i]);
+        playMove(model, getIndexSquare(getFirstBit(moves)));
+        return (uint64_t)model.currentPlayer;
+    });
+
+    runMicroBenchmark(options, "makeMove", suite, [&](int i) {
+        Position position = suite.positions[i];
+        uint64_t hash = 0;
+        MoveUndo undo;
+        for (Bitboard moves = getPositionMoves(position); moves; moves &= moves - 1)
+        {
+            makeMove(position, getFirstBit(moves), undo);
+            hash ^= position.hash;
+            unmakeMove(position, undo);
+        }
+        return hash;
+    });
+
+    runMicroBenchmark(options, "evaluateBoard", suite, [&](int i) {
+        return (uint64_t)evaluateBoard(suite.models[i].board, suite.models[i].currentPlayer);
+    });
+
+    runMicroBenchmark(options, "evaluatePosition", suite, [&](int i) {
+        return (uint64_t)evaluatePosition(suite.positions[i], suite.positions[i].currentPlayer,
+                                          options.weightsPath ? &weights : NULL);
+    });
+
+    runMicroBenchmark(options, "getPositionHash", suite, [&](int i) {
+        return getPositionHash(suite.positions[i]);
+    });
+
+    runMicroBenchmark(options, "getSymmetricBitboards", suite, [&](int i) {
+        Bitboard symmetric[SYMMETRY_COUNT];
+        getSymmetricBitboards(suite.positions[i].discs[PLAYER_BLACK], symmetric);
+        return symmetric[SYMMETRY_COUNT - 1];
+    });
+
+    freePatternWeights(weights);
+
+    runSearchBenchmarks(options, suite);
+
+    runHashingBenchmark(options, "hashing-plain", suite, false);
+    runHashingBenchmark(options, "hashing-canonical", suite, true);
+
+    if (outputFile)
+        fclose(outputFile);
+
+    return 0;
+}
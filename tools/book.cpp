@@ -0,0 +1,277 @@
+/**
+ * @brief Builds the opening book of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Collects the early positions of recorded games (one game per line, moves
+ * written like "f5d6c3") and of self-play games, searches each distinct
+ * position to a fixed depth and writes the book file.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "ai.h"
+#include "book.h"
+
+#define DEFAULT_PLIES 12
+#define DEFAULT_DEPTH 10
+#define DEFAULT_RANDOM_PLIES 4
+
+struct BookOptions
+{
+    const char *gamesPath;
+    int selfPlayGames;
+    int randomPlies;
+    int plies;
+    int depth;
+    unsigned int seed;
+    const char *outputPath;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-book [options] OUTPUT\n"
+                 "  --games FILE     Add the positions of the games in FILE\n"
+                 "  --selfplay N     Add the positions of N self-play games\n"
+                 "  --random N       Random moves opening each self-play game (default "
+              << DEFAULT_RANDOM_PLIES << ")\n"
+                 "  --plies N        Keep positions up to N moves into the game (default "
+              << DEFAULT_PLIES << ")\n"
+                 "  --depth N        Search depth of each book position (default "
+              << DEFAULT_DEPTH << ")\n"
+                 "  --seed N         Self-play random seed\n";
+}
+
+static bool parseOptions(int argc, char *argv[], BookOptions &options)
+{
+    options.gamesPath = NULL;
+    options.selfPlayGames = 0;
+    options.randomPlies = DEFAULT_RANDOM_PLIES;
+    options.plies = DEFAULT_PLIES;
+    options.depth = DEFAULT_DEPTH;
+    options.seed = 1;
+    options.outputPath = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--games") && hasValue)
+            options.gamesPath = argv[++i];
+        else if (!strcmp(argv[i], "--selfplay") && hasValue)
+            options.selfPlayGames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--random") && hasValue)
+            options.randomPlies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--plies") && hasValue)
+            options.plies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            options.seed = (unsigned int)atoi(argv[++i]);
+        else if ((argv[i][0] != '-') && !options.outputPath)
+            options.outputPath = argv[i];
+        else
+            return false;
+    }
+
+    return options.outputPath && (options.depth > 0) && (options.depth < SEARCH_MAX_DEPTH);
+}
+
+/**
+ * @brief Starts a position at the initial setup.
+ */
+static void getStartPosition(Position &position)
+{
+    GameModel model;
+    initModel(model);
+    startModel(model);
+    getPosition(model, position);
+}
+
+/**
+ * @brief Distinct book positions in key orientation: player to move's discs,
+ * then the opponent's.
+ */
+typedef std::set<std::pair<Bitboard, Bitboard>> BookPositions;
+
+/**
+ * @brief Adds a position unless nobody can move.
+ */
+static void addBookPosition(const Position &position, BookPositions &positions)
+{
+    if (position.gameOver || !getPositionMoves(position))
+        return;
+
+    BookRecord key;
+    getBookKey(position.discs[position.currentPlayer],
+               position.discs[position.currentPlayer ^ 1], key);
+    positions.insert(std::make_pair(key.player, key.opponent));
+}
+
+/**
+ * @brief Adds the positions of the recorded games in a file.
+ */
+static bool addRecordedGames(const BookOptions &options, BookPositions &positions)
+{
+    FILE *file = fopen(options.gamesPath, "r");
+    if (!file)
+        return false;
+
+    char line[1024];
+    int gameCount = 0;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        Position position;
+        getStartPosition(position);
+
+        for (int i = 0, ply = 0; line[i] && line[i + 1] && (ply < options.plies); i += 2, ply++)
+        {
+            int x = line[i] - ((line[i] >= 'a') ? 'a' : 'A');
+            int y = line[i + 1] - '1';
+            if ((x < 0) || (x >= BOARD_SIZE) || (y < 0) || (y >= BOARD_SIZE))
+                break;
+
+            int square = y * BOARD_SIZE + x;
+            if (!((getPositionMoves(position) >> square) & 1))
+                break;
+
+            addBookPosition(position, positions);
+
+            MoveUndo undo;
+            applyMove(position, square, undo);
+        }
+
+        gameCount++;
+    }
+
+    fclose(file);
+    std::cerr << "Read " << gameCount << " games" << std::endl;
+
+    return true;
+}
+
+/**
+ * @brief Adds the positions of self-play games: a few random moves, then
+ * the engine's own.
+ */
+static void addSelfPlayGames(const BookOptions &options, AIEngine &engine, BookPositions &positions)
+{
+    std::mt19937 random(options.seed);
+    SearchLimits limits = {options.depth, 0, 0};
+
+    for (int game = 0; game < options.selfPlayGames; game++)
+    {
+        Position position;
+        getStartPosition(position);
+
+        for (int ply = 0; (ply < options.plies) && !position.gameOver; ply++)
+        {
+            addBookPosition(position, positions);
+
+            Bitboard moves = getPositionMoves(position);
+            int square;
+
+            if (ply < options.randomPlies)
+            {
+                int choice = random() % countBits(moves);
+                while (choice--)
+                    moves &= moves - 1;
+                square = getFirstBit(moves);
+            }
+            else
+            {
+                GameModel model;
+                getPositionModel(position, model);
+
+                SearchResult result;
+                square = getSquareIndex(findBestMove(engine, model, limits, result));
+            }
+
+            MoveUndo undo;
+            applyMove(position, square, undo);
+        }
+
+        std::cerr << "\rSelf-play game " << game + 1 << "/" << options.selfPlayGames << std::flush;
+    }
+
+    if (options.selfPlayGames)
+        std::cerr << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    BookOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    AIConfig config;
+    getDefaultAIConfig(config);
+    config.bookPath = NULL;
+
+    AIEngine engine;
+    initAIEngine(engine, config);
+
+    BookPositions positions;
+
+    if (options.gamesPath && !addRecordedGames(options, positions))
+    {
+        std::cerr << "Could not read " << options.gamesPath << std::endl;
+        return 1;
+    }
+    addSelfPlayGames(options, engine, positions);
+
+    // Search each distinct position once, in key orientation
+    std::vector<BookRecord> book;
+    SearchLimits limits = {options.depth, 0, 0};
+
+    for (BookPositions::const_iterator i = positions.begin(); i != positions.end(); i++)
+    {
+        Position position;
+        position.discs[PLAYER_BLACK] = i->first;
+        position.discs[PLAYER_WHITE] = i->second;
+        position.currentPlayer = PLAYER_BLACK;
+        position.gameOver = false;
+
+        GameModel model;
+        getPositionModel(position, model);
+
+        SearchResult result;
+        Square move = findBestMove(engine, model, limits, result);
+
+        BookRecord record;
+        memset(&record, 0, sizeof(record));
+        record.player = i->first;
+        record.opponent = i->second;
+        record.move = (uint8_t)getSquareIndex(move);
+        record.score = (int16_t)result.score;
+        record.depth = (uint8_t)result.depth;
+        book.push_back(record);
+
+        std::cerr << "\rSearched " << book.size() << "/" << positions.size() << std::flush;
+    }
+    std::cerr << std::endl;
+
+    freeAIEngine(engine);
+
+    if (!saveOpeningBook(options.outputPath, book))
+    {
+        std::cerr << "Could not write " << options.outputPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Wrote " << book.size() << " positions to " << options.outputPath << std::endl;
+
+    return 0;
+}
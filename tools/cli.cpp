@@ -0,0 +1,196 @@
+/**
+ * @brief Headless command line front end of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Searches one position and prints the best move, score, depth and speed
+ * on one line, for servers without a display and for scripts.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "ai.h"
+
+#define DEFAULT_MOVE_TIME 1.0
+
+struct CliOptions
+{
+    const char *position;
+    const char *moves;
+    int depth;
+    double moveTime;
+    bool json;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-cli [options]\n"
+                 "  --position TEXT  Position to search: 64 squares a1..h8 (X, O, -) and the\n"
+                 "                   player to move, e.g. \"---...--- X\" (default: start)\n"
+                 "  --moves LIST     Moves played from the position first, e.g. f5d6c3\n"
+                 "  --depth N        Depth limit (no time limit unless --time is given)\n"
+                 "  --time SECONDS   Time per move (default "
+              << DEFAULT_MOVE_TIME << ")\n"
+                 "  --threads N      Search threads\n"
+                 "  --hash MB        Transposition table size\n"
+                 "  --weights FILE   Pattern weight file\n"
+                 "  --book FILE      Opening book file (\"none\" to disable)\n"
+                 "  --canonical      Symmetry-canonical table keys\n"
+                 "  --json           Print the result and search statistics as JSON\n";
+}
+
+static bool parseOptions(int argc, char *argv[], CliOptions &options, AIConfig &config)
+{
+    options.position = NULL;
+    options.moves = NULL;
+    options.depth = 0;
+    options.moveTime = 0;
+    options.json = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--position") && hasValue)
+            options.position = argv[++i];
+        else if (!strcmp(argv[i], "--moves") && hasValue)
+            options.moves = argv[++i];
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--time") && hasValue)
+            options.moveTime = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+            config.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--hash") && hasValue)
+            config.tableSizeMB = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--weights") && hasValue)
+            config.weightsPath = argv[++i];
+        else if (!strcmp(argv[i], "--book") && hasValue)
+        {
+            config.bookPath = argv[++i];
+            if (!strcmp(config.bookPath, "none"))
+                config.bookPath = NULL;
+        }
+        else if (!strcmp(argv[i], "--canonical"))
+            config.canonicalHashing = true;
+        else if (!strcmp(argv[i], "--json"))
+            options.json = true;
+        else
+            return false;
+    }
+
+    if ((config.threads < 1) || (config.threads > SEARCH_MAX_THREADS) ||
+        (options.depth < 0) || (options.depth > SEARCH_MAX_DEPTH) || (options.moveTime < 0))
+        return false;
+
+    // A depth alone searches without a clock
+    if (!options.depth && !options.moveTime)
+        options.moveTime = DEFAULT_MOVE_TIME;
+
+    config.maxDepth = options.depth ? options.depth : SEARCH_MAX_DEPTH;
+    config.moveTime = options.moveTime;
+    config.gameTime = 0;
+
+    return true;
+}
+
+/**
+ * @brief Plays a list of moves like "f5d6c3".
+ */
+static bool playMoves(Position &position, const char *moves)
+{
+    for (; moves[0] && moves[1]; moves += 2)
+    {
+        int x = moves[0] - ((moves[0] >= 'a') ? 'a' : 'A');
+        int y = moves[1] - '1';
+        if ((x < 0) || (x >= BOARD_SIZE) || (y < 0) || (y >= BOARD_SIZE))
+            return false;
+
+        int square = y * BOARD_SIZE + x;
+        if (position.gameOver || !((getPositionMoves(position) >> square) & 1))
+            return false;
+
+        MoveUndo undo;
+        applyMove(position, square, undo);
+    }
+
+    return !moves[0];
+}
+
+int main(int argc, char *argv[])
+{
+    AIConfig config;
+    getDefaultAIConfig(config);
+
+    CliOptions options;
+    if (!parseOptions(argc, argv, options, config))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Position position;
+    if (options.position)
+    {
+        if (!parsePosition(options.position, position))
+        {
+            std::cerr << "Invalid position: " << options.position << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        GameModel model;
+        initModel(model);
+        startModel(model);
+        getPosition(model, position);
+    }
+
+    if (options.moves && !playMoves(position, options.moves))
+    {
+        std::cerr << "Invalid moves: " << options.moves << std::endl;
+        return 1;
+    }
+
+    if (position.gameOver)
+    {
+        std::cerr << "The game is over" << std::endl;
+        return 1;
+    }
+
+    AIEngine engine;
+    initAIEngine(engine, config);
+
+    GameModel model;
+    getPositionModel(position, model);
+
+    SearchLimits limits;
+    getSearchLimits(engine, model, limits);
+
+    SearchResult result;
+    Square move = findBestMove(engine, model, limits, result);
+
+    if (options.json)
+        printf("%s\n", getSearchResultJson(result).c_str());
+    else
+    {
+        double nps = (result.time > 0) ? result.stats.nodes / result.time : 0;
+
+        if (move.x < 0)
+            printf("move pass");
+        else
+            printf("move %c%c", 'a' + move.x, '1' + move.y);
+        printf(" score %d depth %d%s nodes %llu time %.3f nps %.0f\n",
+               result.score, result.depth,
+               result.book ? " book" : (result.solved ? " solved" : ""),
+               (unsigned long long)result.stats.nodes, result.time, nps);
+    }
+
+    freeAIEngine(engine);
+
+    return 0;
+}
@@ -0,0 +1,327 @@
+/**
+ * @brief Perft and move generator checks of the Reversi game model
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Counts the move paths to a given depth (a pass counts as a move, a
+ * finished game as a leaf), checks the counts from the start position
+ * against the published ones, and plays random games comparing the
+ * bitboard move generator with the board-based reference.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+#include "model.h"
+
+#define DEFAULT_DEPTH 9
+#define DEFAULT_RANDOM_GAMES 1000
+
+// Perft from the start position, by depth
+static const uint64_t START_PERFT[] = {
+    1ULL,
+    4ULL,
+    12ULL,
+    56ULL,
+    244ULL,
+    1396ULL,
+    8200ULL,
+    55092ULL,
+    390216ULL,
+    3005288ULL,
+    24571284ULL,
+    212258800ULL,
+    1939886636ULL,
+    18429641748ULL,
+    184042084512ULL,
+};
+
+#define START_PERFT_DEPTHS ((int)(sizeof(START_PERFT) / sizeof(START_PERFT[0])))
+
+struct PerftOptions
+{
+    const char *position;
+    int depth;
+    bool check;
+    int randomGames;
+    unsigned int seed;
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-perft [options]\n"
+                 "  --depth N        Perft depth (default "
+              << DEFAULT_DEPTH << ")\n"
+                 "  --position TEXT  Start from this position (64 squares and the player to move)\n"
+                 "  --check          Check every depth up to N against the known start counts\n"
+                 "  --random N       Compare the move generators over N random games (default "
+              << DEFAULT_RANDOM_GAMES << " with --check)\n"
+                 "  --seed N         Random game seed\n";
+}
+
+static bool parseOptions(int argc, char *argv[], PerftOptions &options)
+{
+    options.position = NULL;
+    options.depth = DEFAULT_DEPTH;
+    options.check = false;
+    options.randomGames = -1;
+    options.seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--position") && hasValue)
+            options.position = argv[++i];
+        else if (!strcmp(argv[i], "--check"))
+            options.check = true;
+        else if (!strcmp(argv[i], "--random") && hasValue)
+            options.randomGames = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            options.seed = (unsigned int)atoi(argv[++i]);
+        else
+            return false;
+    }
+
+    if (options.randomGames < 0)
+        options.randomGames = options.check ? DEFAULT_RANDOM_GAMES : 0;
+
+    if (options.check && (options.position || (options.depth >= START_PERFT_DEPTHS)))
+        return false;
+
+    return options.depth >= 0;
+}
+
+static double getClock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Counts the move paths from a position, with make/unmake.
+ */
+static uint64_t perft(Position &position, int depth)
+{
+    if (!depth)
+        return 1;
+
+    Bitboard moves = getPositionMoves(position);
+    MoveUndo undo;
+
+    if (!moves)
+    {
+        Bitboard opponent = position.discs[position.currentPlayer ^ 1];
+        Bitboard player = position.discs[position.currentPlayer];
+
+        // Neither player can move: the game is over
+        if (!getMovesBitboard(opponent, player))
+            return 1;
+
+        makePass(position, undo);
+        uint64_t count = perft(position, depth - 1);
+        unmakeMove(position, undo);
+
+        return count;
+    }
+
+    // Bulk count at the last move
+    if (depth == 1)
+        return countBits(moves);
+
+    uint64_t count = 0;
+    for (; moves; moves &= moves - 1)
+    {
+        makeMove(position, getFirstBit(moves), undo);
+        count += perft(position, depth - 1);
+        unmakeMove(position, undo);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Runs perft on a position and reports its speed.
+ */
+static uint64_t runPerft(const Position &start, int depth)
+{
+    Position position = start;
+    double startTime = getClock();
+
+    uint64_t count = perft(position, depth);
+
+    double time = getClock() - startTime;
+    printf("perft %d nodes %llu time %.3f nps %.0f\n", depth,
+           (unsigned long long)count, time, (time > 0) ? count / time : 0);
+
+    return count;
+}
+
+/**
+ * @brief Plays a move on a board by walking the eight directions, as the
+ * board-based reference for the bitboard path.
+ */
+static void playReferenceMove(Board board, Player player, Square move)
+{
+    Piece own = (player == PLAYER_BLACK) ? PIECE_BLACK : PIECE_WHITE;
+
+    for (int dy = -1; dy <= 1; dy++)
+    {
+        for (int dx = -1; dx <= 1; dx++)
+        {
+            if (!dx && !dy)
+                continue;
+
+            int x = move.x + dx;
+            int y = move.y + dy;
+            int length = 0;
+
+            while ((x >= 0) && (x < BOARD_SIZE) && (y >= 0) && (y < BOARD_SIZE) &&
+                   (board[y][x] != PIECE_EMPTY) && (board[y][x] != own))
+            {
+                x += dx;
+                y += dy;
+                length++;
+            }
+
+            if (!length || (x < 0) || (x >= BOARD_SIZE) || (y < 0) || (y >= BOARD_SIZE) ||
+                (board[y][x] != own))
+                continue;
+
+            for (int i = 1; i <= length; i++)
+                board[move.y + i * dy][move.x + i * dx] = own;
+        }
+    }
+
+    board[move.y][move.x] = own;
+}
+
+/**
+ * @brief Plays random games, checking at every move that the bitboard
+ * generator and playMove() agree with the board-based reference.
+ */
+static bool compareMoveGenerators(int gameCount, unsigned int seed)
+{
+    std::mt19937 random(seed);
+    uint64_t positionCount = 0;
+
+    for (int game = 0; game < gameCount; game++)
+    {
+        GameModel model;
+        initModel(model);
+        startModel(model);
+
+        while (!model.gameOver)
+        {
+            Position position;
+            getPosition(model, position);
+
+            MoveList validMoves;
+            getValidMoves(model, validMoves);
+
+            Bitboard referenceMoves = 0;
+            for (size_t i = 0; i < validMoves.size(); i++)
+                referenceMoves |= 1ULL << getSquareIndex(validMoves[i]);
+
+            if (referenceMoves != getPositionMoves(position))
+            {
+                printf("move mismatch in game %d\n", game);
+                return false;
+            }
+
+            // The model never leaves a player without moves to play
+            if (validMoves.empty())
+            {
+                printf("no moves for the player to move in game %d\n", game);
+                return false;
+            }
+
+            Square move = validMoves[random() % validMoves.size()];
+            Player player = model.currentPlayer;
+
+            Board board;
+            memcpy(board, model.board, sizeof(board));
+            playReferenceMove(board, player, move);
+
+            Player opponent = (player == PLAYER_BLACK) ? PLAYER_WHITE : PLAYER_BLACK;
+            bool opponentMoves = getValidMovesNumber(board, opponent) > 0;
+            bool playerMoves = getValidMovesNumber(board, player) > 0;
+
+            playMove(model, move);
+            positionCount++;
+
+            if (memcmp(board, model.board, sizeof(board)))
+            {
+                printf("board mismatch in game %d\n", game);
+                return false;
+            }
+
+            if ((model.gameOver != (!opponentMoves && !playerMoves)) ||
+                (!model.gameOver && (model.currentPlayer != (opponentMoves ? opponent : player))))
+            {
+                printf("turn mismatch in game %d\n", game);
+                return false;
+            }
+        }
+    }
+
+    printf("random games %d positions %llu ok\n", gameCount, (unsigned long long)positionCount);
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    PerftOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    Position position;
+    if (options.position)
+    {
+        if (!parsePosition(options.position, position))
+        {
+            std::cerr << "Invalid position: " << options.position << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        GameModel model;
+        initModel(model);
+        startModel(model);
+        getPosition(model, position);
+    }
+
+    bool passed = true;
+
+    if (options.check)
+    {
+        for (int depth = 1; depth <= options.depth; depth++)
+        {
+            if (runPerft(position, depth) != START_PERFT[depth])
+            {
+                printf("perft %d expected %llu\n", depth, (unsigned long long)START_PERFT[depth]);
+                passed = false;
+            }
+        }
+    }
+    else
+        runPerft(position, options.depth);
+
+    if (options.randomGames)
+        passed &= compareMoveGenerators(options.randomGames, options.seed);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,474 @@
+/**
+ * @brief Self-play tournament between two configurations of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Plays engine A against engine B from a set of balanced openings, each
+ * opening once with each colour, running games concurrently. Reports wins,
+ * draws and losses of A, an Elo estimate with its 95% interval, and the
+ * speed of each side.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "ai.h"
+
+#define DEFAULT_OPENING_PLIES 6
+#define DEFAULT_OPENING_COUNT 100
+#define DEFAULT_TABLE_SIZE_MB 16
+#define DEFAULT_MOVE_TIME 0.1
+
+// Openings are ranked by a search of this depth
+#define OPENING_SEARCH_DEPTH 6
+
+#define REPORT_INTERVAL 100
+
+struct TournamentOptions
+{
+    AIConfig configs[2];   // Engines A and B
+    int games;
+    int concurrency;
+    const char *openingsPath;
+    int openingPlies;
+    int openingCount;
+};
+
+/**
+ * @brief Game results, from engine A's point of view, and search speed.
+ */
+struct TournamentScore
+{
+    int wins;
+    int draws;
+    int losses;
+    uint64_t nodes[2];     // Per engine
+    double time[2];
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-tournament [options]\n"
+                 "  --a SPEC         Engine A settings\n"
+                 "  --b SPEC         Engine B settings\n"
+                 "  --games N        Games to play (default: each opening with both colours)\n"
+                 "  --concurrency N  Games played at once (default: one per core)\n"
+                 "  --openings FILE  Opening positions, one per line (64 squares and the player to move)\n"
+                 "  --opening-plies N  Plies of the generated openings (default "
+              << DEFAULT_OPENING_PLIES << ")\n"
+                 "  --opening-count N  Most balanced generated openings kept (default "
+              << DEFAULT_OPENING_COUNT << ")\n"
+                 "\n"
+                 "SPEC is a comma-separated list of: depth=N, time=SECONDS (per move),\n"
+                 "game=SECONDS (per game), hash=MB, threads=N, weights=FILE, book=FILE,\n"
+                 "endgame=EMPTIES, canonical, shallow. Default: time="
+              << DEFAULT_MOVE_TIME << ", hash=" << DEFAULT_TABLE_SIZE_MB
+              << ", threads=1, built-in evaluation, no book.\n";
+}
+
+/**
+ * @brief Parses an engine specification like "depth=8,hash=32". The text is
+ * split in place, so file names point into it.
+ */
+static bool parseEngineSpec(char *spec, AIConfig &config)
+{
+    bool limited = false;
+
+    while (spec && *spec)
+    {
+        char *next = strchr(spec, ',');
+        if (next)
+            *next++ = '\0';
+
+        char *value = strchr(spec, '=');
+        if (value)
+            *value++ = '\0';
+
+        if (!strcmp(spec, "depth") && value)
+        {
+            config.maxDepth = atoi(value);
+            limited = true;
+        }
+        else if (!strcmp(spec, "time") && value)
+        {
+            config.moveTime = atof(value);
+            limited = true;
+        }
+        else if (!strcmp(spec, "game") && value)
+        {
+            config.gameTime = atof(value);
+            limited = true;
+        }
+        else if (!strcmp(spec, "hash") && value)
+            config.tableSizeMB = atoi(value);
+        else if (!strcmp(spec, "threads") && value)
+            config.threads = atoi(value);
+        else if (!strcmp(spec, "weights") && value)
+            config.weightsPath = value;
+        else if (!strcmp(spec, "book") && value)
+            config.bookPath = value;
+        else if (!strcmp(spec, "endgame") && value)
+            config.endgameEmpties = atoi(value);
+        else if (!strcmp(spec, "canonical") && !value)
+            config.canonicalHashing = true;
+        else if (!strcmp(spec, "shallow") && !value)
+            config.shallowOrdering = true;
+        else
+            return false;
+
+        spec = next;
+    }
+
+    if (!limited)
+        config.moveTime = DEFAULT_MOVE_TIME;
+
+    return (config.maxDepth >= 1) && (config.maxDepth <= SEARCH_MAX_DEPTH) &&
+           (config.threads >= 1) && (config.threads <= SEARCH_MAX_THREADS) &&
+           (config.moveTime >= 0) && (config.gameTime >= 0);
+}
+
+static void getDefaultEngineConfig(AIConfig &config)
+{
+    getDefaultAIConfig(config);
+
+    config.tableSizeMB = DEFAULT_TABLE_SIZE_MB;
+    config.threads = 1;
+    config.moveTime = 0;
+    config.gameTime = 0;
+    config.weightsPath = NULL;
+    config.bookPath = NULL;
+}
+
+static bool parseOptions(int argc, char *argv[], TournamentOptions &options)
+{
+    getDefaultEngineConfig(options.configs[0]);
+    getDefaultEngineConfig(options.configs[1]);
+    options.games = 0;
+    options.concurrency = std::thread::hardware_concurrency();
+    options.openingsPath = NULL;
+    options.openingPlies = DEFAULT_OPENING_PLIES;
+    options.openingCount = DEFAULT_OPENING_COUNT;
+
+    char *specs[2] = {NULL, NULL};
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--a") && hasValue)
+            specs[0] = argv[++i];
+        else if (!strcmp(argv[i], "--b") && hasValue)
+            specs[1] = argv[++i];
+        else if (!strcmp(argv[i], "--games") && hasValue)
+            options.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--concurrency") && hasValue)
+            options.concurrency = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--openings") && hasValue)
+            options.openingsPath = argv[++i];
+        else if (!strcmp(argv[i], "--opening-plies") && hasValue)
+            options.openingPlies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--opening-count") && hasValue)
+            options.openingCount = atoi(argv[++i]);
+        else
+            return false;
+    }
+
+    for (int side = 0; side < 2; side++)
+        if (!parseEngineSpec(specs[side], options.configs[side]))
+            return false;
+
+    if (options.concurrency < 1)
+        options.concurrency = 1;
+
+    return (options.games >= 0) && (options.openingPlies >= 0) && (options.openingCount >= 1);
+}
+
+static bool loadOpenings(const char *path, std::vector<Position> &openings)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        // The player to move must have a move: the model never passes itself
+        Position position;
+        if (!parsePosition(line.c_str(), position) || !getPositionMoves(position))
+        {
+            std::cerr << "Invalid opening: " << line << std::endl;
+            return false;
+        }
+
+        openings.push_back(position);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Collects every position a number of plies from the start, one per
+ * symmetry class.
+ */
+static void collectOpenings(Position &position, int plies, std::set<std::pair<Bitboard, Bitboard> > &keys, std::vector<Position> &openings)
+{
+    if (position.gameOver)
+        return;
+
+    if (!plies)
+    {
+        BookRecord key;
+        getBookKey(position.discs[position.currentPlayer], position.discs[position.currentPlayer ^ 1], key);
+
+        if (keys.insert(std::make_pair(key.player, key.opponent)).second)
+            openings.push_back(position);
+        return;
+    }
+
+    for (Bitboard moves = getPositionMoves(position); moves; moves &= moves - 1)
+    {
+        MoveUndo undo;
+        applyMove(position, getFirstBit(moves), undo);
+        collectOpenings(position, plies - 1, keys, openings);
+        unmakeMove(position, undo);
+    }
+}
+
+/**
+ * @brief Generates the openings and keeps the most balanced ones, judged by
+ * a shallow search with the built-in evaluation.
+ */
+static void generateOpenings(const TournamentOptions &options, std::vector<Position> &openings)
+{
+    GameModel model;
+    initModel(model);
+    startModel(model);
+
+    Position start;
+    getPosition(model, start);
+
+    std::set<std::pair<Bitboard, Bitboard> > keys;
+    std::vector<Position> candidates;
+    collectOpenings(start, options.openingPlies, keys, candidates);
+
+    AIConfig config;
+    getDefaultEngineConfig(config);
+    config.maxDepth = OPENING_SEARCH_DEPTH;
+
+    AIEngine engine;
+    initAIEngine(engine, config);
+
+    SearchLimits limits;
+    getSearchLimits(engine, model, limits);
+
+    std::vector<std::pair<int, int> > ranking;
+    for (size_t i = 0; i < candidates.size(); i++)
+    {
+        getPositionModel(candidates[i], model);
+
+        SearchResult result;
+        findBestMove(engine, model, limits, result);
+        ranking.push_back(std::make_pair(abs(result.score), (int)i));
+    }
+
+    freeAIEngine(engine);
+
+    std::sort(ranking.begin(), ranking.end());
+    for (size_t i = 0; (i < ranking.size()) && ((int)i < options.openingCount); i++)
+        openings.push_back(candidates[ranking[i].second]);
+}
+
+/**
+ * @brief Plays one game.
+ *
+ * @param engines Engines A and B.
+ * @param opening The start position.
+ * @param blackSide The engine playing black (0 for A, 1 for B).
+ * @param score Receives the game result and the engines' speed.
+ */
+static void playGame(AIEngine engines[2], const Position &opening, int blackSide, TournamentScore &score)
+{
+    GameModel model;
+    getPositionModel(opening, model);
+
+    for (int side = 0; side < 2; side++)
+        clearTranspositionTable(engines[side].table);
+
+    while (!model.gameOver)
+    {
+        int side = (model.currentPlayer == PLAYER_BLACK) ? blackSide : blackSide ^ 1;
+        AIEngine &engine = engines[side];
+
+        SearchLimits limits;
+        getSearchLimits(engine, model, limits);
+
+        SearchResult result;
+        Square move = findBestMove(engine, model, limits, result);
+
+        score.nodes[side] += result.stats.nodes;
+        score.time[side] += result.time;
+
+        playMove(model, move);
+    }
+
+    int discDifference = getScore(model, PLAYER_BLACK) - getScore(model, PLAYER_WHITE);
+    if (blackSide)
+        discDifference = -discDifference;
+
+    if (discDifference > 0)
+        score.wins++;
+    else if (discDifference < 0)
+        score.losses++;
+    else
+        score.draws++;
+}
+
+/**
+ * @brief Returns the Elo difference matching an expected score.
+ */
+static double getEloDifference(double score)
+{
+    if (score <= 0)
+        return -INFINITY;
+    if (score >= 1)
+        return INFINITY;
+
+    return 400 * log10(score / (1 - score));
+}
+
+/**
+ * @brief Prints the results so far.
+ */
+static void printScore(FILE *file, const TournamentScore &score)
+{
+    int games = score.wins + score.draws + score.losses;
+    if (!games)
+        return;
+
+    // Mean and standard error of A's per-game score
+    double mean = (score.wins + 0.5 * score.draws) / games;
+    double variance = (score.wins * (1 - mean) * (1 - mean) +
+                       score.draws * (0.5 - mean) * (0.5 - mean) +
+                       score.losses * mean * mean) /
+                      games;
+    double error = sqrt(variance / games);
+
+    // Scores are kept half a game inside (0, 1), so a lopsided or short
+    // match still gets finite numbers
+    double bound = 0.5 / games;
+    auto clampScore = [bound](double value)
+    { return std::min(std::max(value, bound), 1 - bound); };
+
+    double elo = getEloDifference(clampScore(mean));
+    double eloMargin = (getEloDifference(clampScore(mean + 1.96 * error)) -
+                        getEloDifference(clampScore(mean - 1.96 * error))) /
+                       2;
+
+    fprintf(file, "games %d wins %d draws %d losses %d score %.1f%% elo %+.1f +/- %.1f",
+            games, score.wins, score.draws, score.losses, 100 * mean, elo, eloMargin);
+
+    for (int side = 0; side < 2; side++)
+        fprintf(file, " nps-%c %.0f", 'a' + side,
+                (score.time[side] > 0) ? score.nodes[side] / score.time[side] : 0);
+
+    fprintf(file, "\n");
+    fflush(file);
+}
+
+int main(int argc, char *argv[])
+{
+    TournamentOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    std::vector<Position> openings;
+    if (options.openingsPath)
+    {
+        if (!loadOpenings(options.openingsPath, openings))
+            return 1;
+    }
+    else
+        generateOpenings(options, openings);
+
+    if (openings.empty())
+    {
+        std::cerr << "No openings" << std::endl;
+        return 1;
+    }
+
+    int gameCount = options.games ? options.games : 2 * (int)openings.size();
+    int workerCount = std::min(options.concurrency, gameCount);
+
+    std::cerr << "Playing " << gameCount << " games from " << openings.size()
+              << " openings, " << workerCount << " at once" << std::endl;
+
+    std::atomic<int> nextGame(0);
+    std::mutex scoreMutex;
+    TournamentScore total;
+    memset(&total, 0, sizeof(total));
+
+    // Game i plays opening i / 2, with A as black on even games
+    auto runWorker = [&]()
+    {
+        AIEngine engines[2];
+        for (int side = 0; side < 2; side++)
+            initAIEngine(engines[side], options.configs[side]);
+
+        for (int game; (game = nextGame++) < gameCount;)
+        {
+            TournamentScore score;
+            memset(&score, 0, sizeof(score));
+
+            playGame(engines, openings[(game / 2) % openings.size()], game & 1, score);
+
+            std::lock_guard<std::mutex> lock(scoreMutex);
+            total.wins += score.wins;
+            total.draws += score.draws;
+            total.losses += score.losses;
+            for (int side = 0; side < 2; side++)
+            {
+                total.nodes[side] += score.nodes[side];
+                total.time[side] += score.time[side];
+            }
+
+            int played = total.wins + total.draws + total.losses;
+            if (((played % REPORT_INTERVAL) == 0) && (played < gameCount))
+                printScore(stderr, total);
+        }
+
+        for (int side = 0; side < 2; side++)
+            freeAIEngine(engines[side]);
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < workerCount; i++)
+        workers.push_back(std::thread(runWorker));
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+
+    printScore(stdout, total);
+
+    return 0;
+}
@@ -0,0 +1,516 @@
+/**
+ * @brief Pattern weight tuner of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ *
+ * Labels positions by engine self-play, then fits the pattern weights of
+ * every game phase by least-squares regression of the final disc
+ * difference, and writes a weight file the engine loads.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ai.h"
+#include "endgame.h"
+
+#define DEFAULT_GAMES 10000
+#define DEFAULT_DEPTH 4
+#define DEFAULT_RANDOM_PLIES 10
+#define DEFAULT_EXACT_EMPTIES 12
+#define DEFAULT_EPOCHS 100
+#define DEFAULT_RATE 1.0
+#define DEFAULT_REGULARIZATION 0.001
+#define DEFAULT_SEED 1
+#define DEFAULT_TABLE_SIZE_MB 16
+
+// Every so many positions, one is held out to measure the fit
+#define VALIDATION_INTERVAL 16
+
+#define REPORT_INTERVAL 10
+
+#define PATTERN_TOTAL_WEIGHTS (PATTERN_PHASES * PATTERN_WEIGHT_COUNT)
+
+struct TuneOptions
+{
+    const char *outputPath;
+    const char *loadPath;
+    const char *savePath;
+    const char *weightsPath;
+    int games;
+    int depth;
+    int randomPlies;
+    int exactEmpties;
+    int epochs;
+    double rate;
+    double regularization;
+    int threads;
+    unsigned int seed;
+};
+
+/**
+ * @brief A labelled position, kept compact so millions fit in memory.
+ */
+struct TrainingPosition
+{
+    Bitboard discs[2]; // Indexed by Player
+    int8_t score;      // Final disc difference, relative to black
+    uint8_t player;    // Player to move, kept for the position files
+};
+
+static void printUsage()
+{
+    std::cerr << "Usage: edaversi-tune [options] OUTPUT\n"
+                 "  --games N          Self-play games to label (default "
+              << DEFAULT_GAMES << ")\n"
+                 "  --depth N          Self-play search depth (default "
+              << DEFAULT_DEPTH << ")\n"
+                 "  --random N         Random plies opening each game (default "
+              << DEFAULT_RANDOM_PLIES << ")\n"
+                 "  --exact N          Play perfectly from N empty squares, so labels are\n"
+                 "                     exact from there (default "
+              << DEFAULT_EXACT_EMPTIES << ")\n"
+                 "  --weights FILE     Pattern weights for self-play (default: built-in evaluation)\n"
+                 "  --load FILE        Train on these positions instead of playing games\n"
+                 "  --save FILE        Write the labelled positions (\"board player; score\")\n"
+                 "  --epochs N         Training passes (default "
+              << DEFAULT_EPOCHS << ")\n"
+                 "  --rate X           Learning rate (default "
+              << DEFAULT_RATE << ")\n"
+                 "  --regularization X Weight decay per pass (default "
+              << DEFAULT_REGULARIZATION << ")\n"
+                 "  --threads N        Worker threads (default: one per core)\n"
+                 "  --seed N           Random seed\n";
+}
+
+static bool parseOptions(int argc, char *argv[], TuneOptions &options)
+{
+    options.outputPath = NULL;
+    options.loadPath = NULL;
+    options.savePath = NULL;
+    options.weightsPath = NULL;
+    options.games = DEFAULT_GAMES;
+    options.depth = DEFAULT_DEPTH;
+    options.randomPlies = DEFAULT_RANDOM_PLIES;
+    options.exactEmpties = DEFAULT_EXACT_EMPTIES;
+    options.epochs = DEFAULT_EPOCHS;
+    options.rate = DEFAULT_RATE;
+    options.regularization = DEFAULT_REGULARIZATION;
+    options.threads = std::thread::hardware_concurrency();
+    options.seed = DEFAULT_SEED;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = (i + 1 < argc);
+
+        if (!strcmp(argv[i], "--games") && hasValue)
+            options.games = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--depth") && hasValue)
+            options.depth = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--random") && hasValue)
+            options.randomPlies = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--exact") && hasValue)
+            options.exactEmpties = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--weights") && hasValue)
+            options.weightsPath = argv[++i];
+        else if (!strcmp(argv[i], "--load") && hasValue)
+            options.loadPath = argv[++i];
+        else if (!strcmp(argv[i], "--save") && hasValue)
+            options.savePath = argv[++i];
+        else if (!strcmp(argv[i], "--epochs") && hasValue)
+            options.epochs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rate") && hasValue)
+            options.rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--regularization") && hasValue)
+            options.regularization = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--threads") && hasValue)
+            options.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && hasValue)
+            options.seed = (unsigned int)atoi(argv[++i]);
+        else if ((argv[i][0] != '-') && !options.outputPath)
+            options.outputPath = argv[i];
+        else
+            return false;
+    }
+
+    if (options.threads < 1)
+        options.threads = 1;
+
+    return options.outputPath && (options.games >= 0) &&
+           (options.depth >= 1) && (options.depth <= SEARCH_MAX_DEPTH) &&
+           (options.randomPlies >= 0) && (options.exactEmpties >= 0) &&
+           (options.epochs >= 0) && (options.rate > 0) && (options.regularization >= 0);
+}
+
+static double getClock()
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @brief Plays one self-play game and labels its positions with the final
+ * disc difference. From options.exactEmpties empty squares on, the engine
+ * solves every move, so those labels are the exact game-theoretic scores.
+ */
+static void playTrainingGame(AIEngine &engine, const TuneOptions &options, int game, std::vector<TrainingPosition> &positions)
+{
+    std::mt19937 random(options.seed * 7919 + game);
+    size_t first = positions.size();
+
+    GameModel model;
+    initModel(model);
+    startModel(model);
+
+    Position position;
+    getPosition(model, position);
+
+    clearTranspositionTable(engine.table);
+
+    for (int ply = 0; !position.gameOver; ply++)
+    {
+        TrainingPosition trainingPosition;
+        trainingPosition.discs[PLAYER_BLACK] = position.discs[PLAYER_BLACK];
+        trainingPosition.discs[PLAYER_WHITE] = position.discs[PLAYER_WHITE];
+        trainingPosition.player = position.currentPlayer;
+        positions.push_back(trainingPosition);
+
+        Bitboard moves = getPositionMoves(position);
+        int square;
+
+        if (ply < options.randomPlies)
+        {
+            for (int skip = random() % countBits(moves); skip > 0; skip--)
+                moves &= moves - 1;
+            square = getFirstBit(moves);
+        }
+        else
+        {
+            int emptyCount = countBits(~(position.discs[PLAYER_BLACK] | position.discs[PLAYER_WHITE]));
+
+            SearchLimits limits;
+            limits.depth = (emptyCount <= options.exactEmpties) ? SEARCH_MAX_DEPTH : options.depth;
+            limits.softTime = 0;
+            limits.hardTime = 0;
+
+            getPositionModel(position, model);
+
+            SearchResult result;
+            findBestMove(engine, model, limits, result);
+            square = getSquareIndex(result.move);
+        }
+
+        MoveUndo undo;
+        applyMove(position, square, undo);
+    }
+
+    int score = getFinalScore(position.discs[PLAYER_BLACK], position.discs[PLAYER_WHITE]);
+    for (size_t i = first; i < positions.size(); i++)
+        positions[i].score = (int8_t)score;
+}
+
+/**
+ * @brief Plays the self-play games on all threads.
+ */
+static void generatePositions(const TuneOptions &options, std::vector<TrainingPosition> &positions)
+{
+    AIConfig config;
+    getDefaultAIConfig(config);
+    config.tableSizeMB = DEFAULT_TABLE_SIZE_MB;
+    config.threads = 1;
+    config.weightsPath = options.weightsPath;
+    config.bookPath = NULL;
+    if (config.endgameEmpties < options.exactEmpties)
+        config.endgameEmpties = options.exactEmpties;
+
+    std::vector<std::vector<TrainingPosition> > threadPositions(options.threads);
+    std::vector<std::thread> threads;
+
+    for (int t = 0; t < options.threads; t++)
+    {
+        threads.push_back(std::thread([&, t]()
+                                      {
+                                          AIEngine engine;
+                                          initAIEngine(engine, config);
+
+                                          // Games are seeded by number, so the set does not depend on the threads
+                                          for (int game = t; game < options.games; game += options.threads)
+                                              playTrainingGame(engine, options, game, threadPositions[t]);
+
+                                          freeAIEngine(engine);
+                                      }));
+    }
+
+    for (int t = 0; t < options.threads; t++)
+    {
+        threads[t].join();
+        positions.insert(positions.end(), threadPositions[t].begin(), threadPositions[t].end());
+    }
+}
+
+static bool loadPositions(const char *path, std::vector<TrainingPosition> &positions)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        Position position;
+        size_t separator = line.find(';');
+        if ((separator == std::string::npos) || !parsePosition(line.c_str(), position))
+        {
+            std::cerr << "Invalid position: " << line << std::endl;
+            return false;
+        }
+
+        // Scores are relative to the player to move, as in OBF files
+        int score = atoi(line.c_str() + separator + 1);
+        if (position.currentPlayer == PLAYER_WHITE)
+            score = -score;
+
+        TrainingPosition trainingPosition;
+        trainingPosition.discs[PLAYER_BLACK] = position.discs[PLAYER_BLACK];
+        trainingPosition.discs[PLAYER_WHITE] = position.discs[PLAYER_WHITE];
+        trainingPosition.score = (int8_t)std::max(-64, std::min(64, score));
+        trainingPosition.player = position.currentPlayer;
+        positions.push_back(trainingPosition);
+    }
+
+    return true;
+}
+
+static bool savePositions(const char *path, const std::vector<TrainingPosition> &positions)
+{
+    FILE *file = fopen(path, "w");
+    if (!file)
+        return false;
+
+    // OBF scores are relative to the player to move
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        char board[BOARD_SIZE * BOARD_SIZE + 1];
+        for (int square = 0; square < BOARD_SIZE * BOARD_SIZE; square++)
+        {
+            Bitboard bit = 1ULL << square;
+            board[square] = (positions[i].discs[PLAYER_BLACK] & bit) ? 'X' : (positions[i].discs[PLAYER_WHITE] & bit) ? 'O' : '-';
+        }
+        board[BOARD_SIZE * BOARD_SIZE] = '\0';
+
+        bool white = (positions[i].player == PLAYER_WHITE);
+        fprintf(file, "%s %c; %+d\n", board, white ? 'O' : 'X',
+                white ? -positions[i].score : positions[i].score);
+    }
+
+    return fclose(file) == 0;
+}
+
+/**
+ * @brief Gets the weight index of every feature of a position, within the
+ * weights of all phases, and its phase.
+ */
+static void getWeightIndices(Bitboard black, Bitboard white, int weightIndices[PATTERN_FEATURES])
+{
+    Position position;
+    position.discs[PLAYER_BLACK] = black;
+    position.discs[PLAYER_WHITE] = white;
+
+    PatternIndices indices;
+    getPatternIndices(position, indices);
+
+    int phaseOffset = getPatternPhase(countBits(black | white)) * PATTERN_WEIGHT_COUNT;
+    for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+        weightIndices[feature] = phaseOffset + getPatternWeightOffset(feature) + indices.indices[feature];
+}
+
+/**
+ * @brief Calls a function with the weight indices and label of a position
+ * and of its colour-swapped copy, which doubles the training data.
+ */
+template <typename Function>
+static void visitSamples(const TrainingPosition &position, Function function)
+{
+    int weightIndices[PATTERN_FEATURES];
+
+    getWeightIndices(position.discs[PLAYER_BLACK], position.discs[PLAYER_WHITE], weightIndices);
+    function(weightIndices, position.score);
+
+    getWeightIndices(position.discs[PLAYER_WHITE], position.discs[PLAYER_BLACK], weightIndices);
+    function(weightIndices, -position.score);
+}
+
+static float predict(const std::vector<float> &weights, const int weightIndices[PATTERN_FEATURES])
+{
+    float prediction = 0;
+    for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+        prediction += weights[weightIndices[feature]];
+
+    return prediction;
+}
+
+/**
+ * @brief Fits the weights, in discs, by gradient descent on the squared
+ * error. Each weight's step is divided by how often it occurs, so rare
+ * configurations learn as fast as common ones. The gradient is summed on
+ * all threads, each over its own slice of the positions.
+ */
+static void trainWeights(const TuneOptions &options, const std::vector<TrainingPosition> &training,
+                         const std::vector<TrainingPosition> &validation, std::vector<float> &weights)
+{
+    weights.assign(PATTERN_TOTAL_WEIGHTS, 0);
+
+    std::vector<float> counts(PATTERN_TOTAL_WEIGHTS, 0);
+    for (size_t i = 0; i < training.size(); i++)
+        visitSamples(training[i], [&](const int weightIndices[], int)
+                     {
+                         for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+                             counts[weightIndices[feature]]++;
+                     });
+
+    std::vector<std::vector<float> > gradients(options.threads, std::vector<float>(PATTERN_TOTAL_WEIGHTS));
+    std::vector<double> errors(options.threads);
+
+    for (int epoch = 1; epoch <= options.epochs; epoch++)
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < options.threads; t++)
+        {
+            threads.push_back(std::thread([&, t]()
+                                          {
+                                              std::vector<float> &gradient = gradients[t];
+                                              std::fill(gradient.begin(), gradient.end(), 0.0f);
+                                              errors[t] = 0;
+
+                                              size_t begin = training.size() * t / options.threads;
+                                              size_t end = training.size() * (t + 1) / options.threads;
+                                              for (size_t i = begin; i < end; i++)
+                                                  visitSamples(training[i], [&](const int weightIndices[], int score)
+                                                               {
+                                                                   float residual = score - predict(weights, weightIndices);
+                                                                   errors[t] += residual * residual;
+
+                                                                   for (int feature = 0; feature < PATTERN_FEATURES; feature++)
+                                                                       gradient[weightIndices[feature]] += residual;
+                                                               });
+                                          }));
+        }
+
+        double error = 0;
+        for (int t = 0; t < options.threads; t++)
+        {
+            threads[t].join();
+            error += errors[t];
+        }
+
+        for (int i = 0; i < PATTERN_TOTAL_WEIGHTS; i++)
+        {
+            if (!counts[i])
+                continue;
+
+            float gradient = 0;
+            for (int t = 0; t < options.threads; t++)
+                gradient += gradients[t][i];
+
+            // A sum of PATTERN_FEATURES weights moves per sample, so each
+            // takes its share of the step
+            weights[i] += (float)(options.rate / PATTERN_FEATURES) * gradient / counts[i];
+            weights[i] *= (float)(1 - options.regularization);
+        }
+
+        if (((epoch % REPORT_INTERVAL) == 0) || (epoch == options.epochs))
+        {
+            double validationError = 0;
+            for (size_t i = 0; i < validation.size(); i++)
+                visitSamples(validation[i], [&](const int weightIndices[], int score)
+                             {
+                                 float residual = score - predict(weights, weightIndices);
+                                 validationError += residual * residual;
+                             });
+
+            fprintf(stderr, "epoch %d rmse %.3f validation %.3f\n", epoch,
+                    training.empty() ? 0 : sqrt(error / (2 * training.size())),
+                    validation.empty() ? 0 : sqrt(validationError / (2 * validation.size())));
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    TuneOptions options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    double startTime = getClock();
+
+    std::vector<TrainingPosition> positions;
+    if (options.loadPath)
+    {
+        if (!loadPositions(options.loadPath, positions))
+            return 1;
+    }
+    else
+        generatePositions(options, positions);
+
+    fprintf(stderr, "positions %zu time %.1f\n", positions.size(), getClock() - startTime);
+
+    if (options.savePath && !savePositions(options.savePath, positions))
+    {
+        std::cerr << "Could not write " << options.savePath << std::endl;
+        return 1;
+    }
+
+    std::vector<TrainingPosition> training;
+    std::vector<TrainingPosition> validation;
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        if ((i % VALIDATION_INTERVAL) == VALIDATION_INTERVAL - 1)
+            validation.push_back(positions[i]);
+        else
+            training.push_back(positions[i]);
+    }
+    positions.clear();
+    positions.shrink_to_fit();
+
+    std::vector<float> weights;
+    trainWeights(options, training, validation, weights);
+
+    // Weights are stored in evaluation units, relative to black
+    std::vector<int16_t> fileWeights(PATTERN_TOTAL_WEIGHTS);
+    for (int i = 0; i < PATTERN_TOTAL_WEIGHTS; i++)
+    {
+        float weight = roundf(weights[i] * PATTERN_DISC_SCALE);
+        fileWeights[i] = (int16_t)std::max(-32767.0f, std::min(32767.0f, weight));
+    }
+
+    if (!savePatternWeights(options.outputPath, &fileWeights[0]))
+    {
+        std::cerr << "Could not write " << options.outputPath << std::endl;
+        return 1;
+    }
+
+    fprintf(stderr, "wrote %s time %.1f\n", options.outputPath, getClock() - startTime);
+
+    return 0;
+}
@@ -0,0 +1,236 @@
+/**
+ * @brief Implements the transposition table of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "transposition.h"
+
+/**
+ * @brief Allocates cache-line aligned memory, with huge pages if requested
+ * and available.
+ *
+ * @param table The table whose allocation flags are set.
+ * @param size The size in bytes.
+ * @param hugePages Try to use huge pages.
+ * @return The memory, or NULL.
+ */
+static void *allocateTable(TranspositionTable &table, size_t size, bool hugePages)
+{
+    table.mapped = false;
+
+#if defined(__linux__)
+    if (hugePages)
+    {
+        // Explicit huge pages, then transparent huge pages
+        void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory == MAP_FAILED)
+        {
+            memory = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory != MAP_FAILED)
+                madvise(memory, size, MADV_HUGEPAGE);
+        }
+
+        if (memory != MAP_FAILED)
+        {
+            table.mapped = true;
+            return memory;
+        }
+    }
+#else
+    (void)hugePages;
+#endif
+
+#if defined(_WIN32)
+    return _aligned_malloc(size, sizeof(TranspositionBucket));
+#else
+    void *memory;
+    if (posix_memalign(&memory, sizeof(TranspositionBucket), size))
+        return NULL;
+    return memory;
+#endif
+}
+
+bool initTranspositionTable(TranspositionTable &table, size_t sizeMB, bool hugePages)
+{
+    size_t bucketCount = 1;
+    while (2 * bucketCount * sizeof(TranspositionBucket) <= (sizeMB << 20))
+        bucketCount *= 2;
+
+    table.allocatedSize = bucketCount * sizeof(TranspositionBucket);
+    table.buckets = (TranspositionBucket *)allocateTable(table, table.allocatedSize, hugePages);
+    table.bucketMask = bucketCount - 1;
+    table.age = 0;
+
+    if (!table.buckets)
+    {
+        table.allocatedSize = 0;
+        table.bucketMask = 0;
+        return false;
+    }
+
+    clearTranspositionTable(table);
+
+    return true;
+}
+
+void freeTranspositionTable(TranspositionTable &table)
+{
+    if (!table.buckets)
+        return;
+
+#if defined(__linux__)
+    if (table.mapped)
+        munmap(table.buckets, table.allocatedSize);
+    else
+        free(table.buckets);
+#elif defined(_WIN32)
+    _aligned_free(table.buckets);
+#else
+    free(table.buckets);
+#endif
+
+    table.buckets = NULL;
+    table.allocatedSize = 0;
+    table.bucketMask = 0;
+}
+
+void clearTranspositionTable(TranspositionTable &table)
+{
+    if (table.buckets)
+        memset((void *)table.buckets, 0, table.allocatedSize);
+}
+
+void ageTranspositionTable(TranspositionTable &table)
+{
+    table.age++;
+}
+
+/**
+ * @brief Packing of the data word of an entry.
+ */
+#define ENTRY_EVAL(data) ((int16_t)((data) & 0xffff))
+#define ENTRY_MOVE(data) ((int8_t)(((data) >> 16) & 0xff))
+#define ENTRY_DEPTH(data) ((int)(((data) >> 24) & 0xff))
+#define ENTRY_BOUND(data) ((Bound)(((data) >> 32) & 0xff))
+#define ENTRY_AGE(data) ((uint8_t)(((data) >> 40) & 0xff))
+
+static uint64_t packEntry(int eval, int move, int depth, Bound bound, uint8_t age)
+{
+    return ((uint64_t)(uint16_t)(int16_t)eval) |
+           ((uint64_t)(uint8_t)(int8_t)move << 16) |
+           ((uint64_t)(uint8_t)depth << 24) |
+           ((uint64_t)(uint8_t)bound << 32) |
+           ((uint64_t)age << 40);
+}
+
+bool probeTranspositionTable(TranspositionTable &table, uint64_t hash, NodePunctuation &node)
+{
+    if (!table.buckets)
+        return false;
+
+    TranspositionBucket &bucket = table.buckets[hash & table.bucketMask];
+
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+    {
+        TranspositionEntry &entry = bucket.entries[i];
+
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+        if (((check ^ data) == hash) && ENTRY_DEPTH(data))
+        {
+            // Still useful: refresh it
+            if (ENTRY_AGE(data) != table.age)
+            {
+                data = packEntry(ENTRY_EVAL(data), ENTRY_MOVE(data), ENTRY_DEPTH(data),
+                                 ENTRY_BOUND(data), table.age);
+                entry.data.store(data, std::memory_order_relaxed);
+                entry.check.store(hash ^ data, std::memory_order_relaxed);
+            }
+
+            node.eval = ENTRY_EVAL(data);
+            node.bound = ENTRY_BOUND(data);
+            node.depth = ENTRY_DEPTH(data) - 1;
+            node.move = ENTRY_MOVE(data);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void storeTranspositionTable(TranspositionTable &table, uint64_t hash, const NodePunctuation &node)
+{
+    if (!table.buckets)
+        return;
+
+    TranspositionBucket &bucket = table.buckets[hash & table.bucketMask];
+
+    // Same position, or else the entry with the lowest depth, counting each
+    // search generation of age as two plies of depth
+    TranspositionEntry *victim = NULL;
+    uint64_t victimData = 0;
+    bool victimMatches = false;
+    int victimValue = 0;
+
+    for (int i = 0; i < TRANSPOSITION_BUCKET_SIZE; i++)
+    {
+        TranspositionEntry &entry = bucket.entries[i];
+
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+
+        if ((check ^ data) == hash)
+        {
+            victim = &entry;
+            victimData = data;
+            victimMatches = true;
+            break;
+        }
+
+        int entryAge = (uint8_t)(table.age - ENTRY_AGE(data));
+        int value = ENTRY_DEPTH(data) - 2 * entryAge;
+
+        if (!victim || (value < victimValue))
+        {
+            victim = &entry;
+            victimData = data;
+            victimValue = value;
+        }
+    }
+
+    int move = node.move;
+
+    if (victimMatches)
+    {
+        // Keep deeper results of the same position from this search unless
+        // the new result is exact
+        if ((ENTRY_AGE(victimData) == table.age) &&
+            (ENTRY_DEPTH(victimData) > node.depth + 1) &&
+            (node.bound != EXACT))
+            return;
+
+        if (move < 0)
+            move = ENTRY_MOVE(victimData);
+    }
+
+    // Depth 0 marks an empty entry
+    uint64_t data = packEntry(node.eval, move, node.depth + 1, node.bound, table.age);
+
+    victim->data.store(data, std::memory_order_relaxed);
+    victim->check.store(hash ^ data, std::memory_order_relaxed);
+}
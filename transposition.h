@@ -0,0 +1,122 @@
+/**
+ * @brief Implements the transposition table of the Reversi game AI
+ * @author Marc S. Ressl
+ *
+ * @copyright Copyright (c) 2023-2024
+ */
+
+#ifndef TRANSPOSITION_H
+#define TRANSPOSITION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum Bound
+{
+	EXACT,
+	LOWER_BOUND,
+	UPPER_BOUND
+};
+
+/**
+ * @brief A search result as stored in the transposition table.
+ */
+struct NodePunctuation
+{
+	int eval;  // Relative to the player to move
+	Bound bound;
+	int depth;
+	int move;  // Best move square index, -1 if none
+};
+
+/**
+ * @brief A transposition table slot, packed in 16 bytes. Both words are
+ * written without locks; the key is stored XORed with the data, so a slot
+ * torn by two concurrent writes fails the key check instead of returning
+ * mixed data.
+ */
+struct TranspositionEntry
+{
+	std::atomic<uint64_t> check; // Key XOR data
+	std::atomic<uint64_t> data;  // Eval, move, depth, bound and age
+};
+
+#define TRANSPOSITION_BUCKET_SIZE 4
+
+/**
+ * @brief A group of entries sharing one cache line.
+ */
+struct alignas(64) TranspositionBucket
+{
+	TranspositionEntry entries[TRANSPOSITION_BUCKET_SIZE];
+};
+
+/**
+ * @brief Fixed-size, preallocated hash table of search results, safe to share
+ * between search threads.
+ */
+struct TranspositionTable
+{
+	TranspositionBucket *buckets;
+	uint64_t bucketMask; // Number of buckets (a power of two) minus one
+
+	uint8_t age;         // Search generation, see ageTranspositionTable()
+
+	size_t allocatedSize;
+	bool mapped;         // Allocated with mmap() instead of the heap
+};
+
+/**
+ * @brief Allocates a transposition table.
+ *
+ * @param table The table.
+ * @param sizeMB The maximum size in megabytes, rounded down to a power of two.
+ * @param hugePages Try to back the table with huge pages.
+ * @return Whether the table could be allocated.
+ */
+bool initTranspositionTable(TranspositionTable &table, size_t sizeMB, bool hugePages);
+
+/**
+ * @brief Frees a transposition table.
+ *
+ * @param table The table.
+ */
+void freeTranspositionTable(TranspositionTable &table);
+
+/**
+ * @brief Empties a transposition table.
+ *
+ * @param table The table.
+ */
+void clearTranspositionTable(TranspositionTable &table);
+
+/**
+ * @brief Starts a new search generation, so entries from older searches are
+ * replaced first.
+ *
+ * @param table The table.
+ */
+void ageTranspositionTable(TranspositionTable &table);
+
+/**
+ * @brief Looks a position up.
+ *
+ * @param table The table.
+ * @param hash The position's Zobrist hash.
+ * @param node Receives the stored result.
+ * @return Whether the position was found.
+ */
+bool probeTranspositionTable(TranspositionTable &table, uint64_t hash, NodePunctuation &node);
+
+/**
+ * @brief Stores a search result, replacing the least valuable entry of the
+ * bucket (shallowest and oldest first).
+ *
+ * @param table The table.
+ * @param hash The position's Zobrist hash.
+ * @param node The result.
+ */
+void storeTranspositionTable(TranspositionTable &table, uint64_t hash, const NodePunctuation &node);
+
+#endif
@@ -199,7 +199,7 @@ void drawView(GameModel &model)
                 6,
                 DARKGREEN);
             
-            Moves validMoves;
+            MoveList validMoves;
             getValidMoves(model, validMoves);
             for (const auto& move : validMoves)
             {